@@ -69,6 +69,8 @@ int main(int argc, char* argv[]) {
   display().title   = "Contours  ";  
   display()         = ccmpl::view2d({-XRADIUS, XRADIUS}, {-YRADIUS, YRADIUS}, ccmpl::aspect::equal, ccmpl::span::placeholder); 
   display()        += ccmpl::contours("", 9, fill_data); // 9 = label fontsize, 0 removes labels.
+  // For large grids, ccmpl::contours("cmap='jet'", 0, fill_data, ccmpl::extraction::cpp) computes
+  // the isolines in C++ and only sends their segments (no labels in that case).
   display++;
 
   // the ccmpl::Main object handles generation here.
@@ -26,10 +26,12 @@
 
 #pragma once
 
+#include <ccmplAlgo.hpp>
 #include <ccmplChart.hpp>
 #include <ccmplDraw.hpp>
 #include <ccmplMain.hpp>
 #include <ccmplPython.hpp>
+#include <ccmplStats.hpp>
 #include <ccmplTypes.hpp>
 #include <ccmplUtility.hpp>
 
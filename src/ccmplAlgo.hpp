@@ -0,0 +1,1372 @@
+/*   This file is part of ccmpl
+ *
+ *   Copyright (C) 2015,  CentraleSupelec
+ *
+ *   Author : Herve Frezza-Buet
+ *
+ *   Contributor :
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU General Public
+ *   License (GPL) as published by the Free Software Foundation; either
+ *   version 3 of the License, or any later version.
+ *   
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *   General Public License for more details.
+ *   
+ *   You should have received a copy of the GNU General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ *   Contact : Herve.Frezza-Buet@centralesupelec.fr
+ *
+ */
+
+#pragma once
+
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <array>
+#include <iterator>
+#include <complex>
+#include <limits>
+
+#include <ccmplTypes.hpp>
+#include <ccmplUtility.hpp>
+
+namespace ccmpl {
+
+  namespace internal {
+    inline Point on_edge(const Point& a, double za, const Point& b, double zb, double level) {
+      double t = (level - za)/(zb - za);
+      return {a.x + t*(b.x - a.x), a.y + t*(b.y - a.y)};
+    }
+  }
+
+  /**
+   * This namespace gathers the computations that elements perform in C++ in order to reduce what is sent to matplotlib.
+   */
+  namespace algo {
+
+    typedef std::pair<Point, Point> Segment;
+
+    /**
+     * This extracts the isolines of a regular grid with the marching squares algorithm.
+     * @param z The values, row by row (nb_x values for y = ymin first).
+     * @param levels The values of the isolines.
+     * @param segments segments[l] receives the segments of the isoline at levels[l].
+     * The (level, row block) pairs are processed in parallel.
+     */
+    inline void marching_squares(const std::vector<double>& z,
+				 double xmin, double xmax, unsigned int nb_x,
+				 double ymin, double ymax, unsigned int nb_y,
+				 const std::vector<double>& levels,
+				 std::vector<std::vector<Segment>>& segments) {
+      segments.resize(levels.size());
+      for(auto& s : segments) s.clear();
+      if(nb_x < 2 || nb_y < 2 || z.size() < nb_x*nb_y) return;
+	
+      double dx = (xmax - xmin)/(nb_x - 1);
+      double dy = (ymax - ymin)/(nb_y - 1);
+      unsigned int nb_cells  = nb_y - 1;
+      unsigned int nb_blocks = std::max(1u, std::min(nb_cells, internal::nb_threads()));
+      std::vector<std::vector<Segment>> parts(levels.size()*nb_blocks);
+
+      internal::parallel_for(parts.size(), internal::grain_for(nb_x*(nb_cells/nb_blocks + 1)),
+				    [&](unsigned int, std::size_t begin, std::size_t end) {
+	for(std::size_t p = begin; p < end; ++p) {
+	  double level       = levels[p / nb_blocks];
+	  unsigned int block = p % nb_blocks;
+	  auto& out          = parts[p];
+	  for(unsigned int i = (block*nb_cells)/nb_blocks; i < ((block+1)*nb_cells)/nb_blocks; ++i) {
+	    const double* row0 = z.data() + i*nb_x;
+	    const double* row1 = row0 + nb_x;
+	    double y0 = ymin + i*dy;
+	    double y1 = y0 + dy;
+	    for(unsigned int j = 0; j + 1 < nb_x; ++j) {
+	      double z00 = row0[j], z01 = row0[j+1], z10 = row1[j], z11 = row1[j+1];
+	      unsigned int c = (z00 >= level) | ((z01 >= level) << 1) | ((z11 >= level) << 2) | ((z10 >= level) << 3);
+	      if(c == 0 || c == 15) continue;
+		
+	      double x0 = xmin + j*dx;
+	      double x1 = x0 + dx;
+	      Point p00(x0, y0), p01(x1, y0), p10(x0, y1), p11(x1, y1);
+	      auto bottom = [&]() {return internal::on_edge(p00, z00, p01, z01, level);};
+	      auto right  = [&]() {return internal::on_edge(p01, z01, p11, z11, level);};
+	      auto top    = [&]() {return internal::on_edge(p10, z10, p11, z11, level);};
+	      auto left   = [&]() {return internal::on_edge(p00, z00, p10, z10, level);};
+	      bool center = .25*(z00 + z01 + z10 + z11) >= level;
+		
+	      switch(c) {
+	      case  1: case 14: out.emplace_back(left(),   bottom()); break;
+	      case  2: case 13: out.emplace_back(bottom(), right());  break;
+	      case  3: case 12: out.emplace_back(left(),   right());  break;
+	      case  4: case 11: out.emplace_back(right(),  top());    break;
+	      case  6: case  9: out.emplace_back(bottom(), top());    break;
+	      case  7: case  8: out.emplace_back(left(),   top());    break;
+	      case  5:
+		if(center) {out.emplace_back(bottom(), right());  out.emplace_back(left(),  top());}
+		else       {out.emplace_back(left(),   bottom()); out.emplace_back(right(), top());}
+		break;
+	      case 10:
+		if(center) {out.emplace_back(left(),   bottom()); out.emplace_back(right(), top());}
+		else       {out.emplace_back(bottom(), right());  out.emplace_back(left(),  top());}
+		break;
+	      default: break;
+	      }
+	    }
+	  }
+	}
+      });
+
+      for(unsigned int l = 0; l < levels.size(); ++l) 
+	for(unsigned int b = 0; b < nb_blocks; ++b) {
+	  auto& part = parts[l*nb_blocks + b];
+	  segments[l].insert(segments[l].end(), part.begin(), part.end());
+	}
+    }
+
+    /**
+     * This is a uniform grid of width x height cells covering [xmin,xmax]x[ymin,ymax]. Cells are stored row by row, starting from ymin.
+     */
+    struct Frame {
+      double xmin, xmax, ymin, ymax;
+      unsigned int width, height;
+      Frame() : xmin(0), xmax(1), ymin(0), ymax(1), width(0), height(0) {}
+      Frame(double xmin, double xmax, double ymin, double ymax, unsigned int width, unsigned int height)
+	: xmin(xmin), xmax(xmax), ymin(ymin), ymax(ymax), width(width), height(height) {}
+      unsigned int size() const {return width*height;}
+    };
+
+    /**
+     * This computes the bounding box of the (x,y) of the items in [begin,end), in parallel. Empty or flat boxes are enlarged so that the frame is never degenerated.
+     */
+    template<typename IT>
+    Frame bounding_frame(IT begin, IT end, unsigned int width, unsigned int height) {
+      std::size_t size = std::distance(begin, end);
+      unsigned int nb = internal::nb_chunks(size, 4096);
+      std::vector<std::array<double, 4>> boxes(nb, {{HUGE_VAL, -HUGE_VAL, HUGE_VAL, -HUGE_VAL}});
+      internal::parallel_for(size, 4096,
+			     [&boxes, begin](unsigned int chunk, std::size_t first, std::size_t last) {
+			       auto& box = boxes[chunk];
+			       for(auto it = begin + first, stop = begin + last; it != stop; ++it) {
+				 box[0] = std::min(box[0], it->x); box[1] = std::max(box[1], it->x);
+				 box[2] = std::min(box[2], it->y); box[3] = std::max(box[3], it->y);
+			       }
+			     });
+      Frame res(HUGE_VAL, -HUGE_VAL, HUGE_VAL, -HUGE_VAL, width, height);
+      for(auto& box : boxes) {
+	res.xmin = std::min(res.xmin, box[0]); res.xmax = std::max(res.xmax, box[1]);
+	res.ymin = std::min(res.ymin, box[2]); res.ymax = std::max(res.ymax, box[3]);
+      }
+      if(res.xmin > res.xmax) {res.xmin = 0; res.xmax = 1;}
+      if(res.ymin > res.ymax) {res.ymin = 0; res.ymax = 1;}
+      if(res.xmin == res.xmax) {res.xmin -= .5; res.xmax += .5;}
+      if(res.ymin == res.ymax) {res.ymin -= .5; res.ymax += .5;}
+      return res;
+    }
+
+    /**
+     * This computes the minimal and maximal values of proj(item) for the items in [begin,end), in parallel if the iterators are random access ones. NaNs are ignored, and the result is (HUGE_VAL, -HUGE_VAL) if there is no value.
+     */
+    template<typename IT, typename PROJ>
+    std::pair<double, double> bounds(IT begin, IT end, const PROJ& proj) {
+      if constexpr(!internal::random_access<IT>) {
+	std::pair<double, double> res = {HUGE_VAL, -HUGE_VAL};
+	for(; begin != end; ++begin) {
+	  double v = proj(*begin);
+	  if(v < res.first)  res.first  = v;
+	  if(v > res.second) res.second = v;
+	}
+	return res;
+      }
+      else {
+	std::size_t size = std::distance(begin, end);
+	unsigned int nb = internal::nb_chunks(size, 4096);
+	std::vector<std::pair<double, double>> parts(nb, {HUGE_VAL, -HUGE_VAL});
+	internal::parallel_for(size, 4096,
+			       [&parts, &proj, begin](unsigned int chunk, std::size_t first, std::size_t last) {
+				 auto& part = parts[chunk];
+				 for(auto it = begin + first, stop = begin + last; it != stop; ++it) {
+				   double v = proj(*it);
+				   if(v < part.first)  part.first  = v;
+				   if(v > part.second) part.second = v;
+				 }
+			       });
+	std::pair<double, double> res = {HUGE_VAL, -HUGE_VAL};
+	for(auto& part : parts) {
+	  res.first  = std::min(res.first,  part.first);
+	  res.second = std::max(res.second, part.second);
+	}
+	return res;
+      }
+    }
+
+    /**
+     * This accumulates the items in [begin,end) into the cells of the frame. For each cell, acc contains DIM+1 values: the number of items in the cell, followed by the sums of the DIM values that channels(item, double* values) computes for each item. Items out of the frame are ignored.
+     *
+     * The items are split in chunks handled in parallel, each one with a private accumulator. Chunks contain at least as many items as the frame has cells, so that this extra memory stays proportional to the data.
+     */
+    template<unsigned int DIM, typename IT, typename CHANNELS>
+    void splat(IT begin, IT end, const Frame& frame, const CHANNELS& channels, std::vector<double>& acc) {
+      constexpr unsigned int stride = DIM + 1;
+      std::size_t size = std::distance(begin, end);
+      std::size_t grain = std::max<std::size_t>(4096, frame.size());
+      unsigned int nb = internal::nb_chunks(size, grain);
+      acc.assign(stride*frame.size(), 0);
+      std::vector<std::vector<double>> privates(nb > 1 ? nb - 1 : 0, std::vector<double>(stride*frame.size(), 0));
+      double xcoef = frame.width /(frame.xmax - frame.xmin);
+      double ycoef = frame.height/(frame.ymax - frame.ymin);
+
+      internal::parallel_for(size, grain,
+			     [&](unsigned int chunk, std::size_t first, std::size_t last) {
+			       double* cells = chunk == 0 ? acc.data() : privates[chunk-1].data();
+			       double values[DIM > 0 ? DIM : 1];
+			       for(auto it = begin + first, stop = begin + last; it != stop; ++it) {
+				 double x = (it->x - frame.xmin)*xcoef;
+				 double y = (it->y - frame.ymin)*ycoef;
+				 if(!(x >= 0 && y >= 0 && x <= frame.width && y <= frame.height)) continue;
+				 unsigned int col = std::min((unsigned int)x, frame.width  - 1);
+				 unsigned int row = std::min((unsigned int)y, frame.height - 1);
+				 double* cell = cells + stride*(row*frame.width + col);
+				 channels(*it, values);
+				 cell[0] += 1;
+				 for(unsigned int d = 0; d < DIM; ++d) cell[d+1] += values[d];
+			       }
+			     });
+
+      if(privates.size() != 0)
+	internal::parallel_for(acc.size(), 4096,
+			       [&acc, &privates](unsigned int, std::size_t first, std::size_t last) {
+				 for(auto& p : privates)
+				   for(std::size_t i = first; i < last; ++i)
+				     acc[i] += p[i];
+			       });
+    }
+
+    /**
+     * This computes, for each cell, an approximation (3-4 chamfer distance) of its distance, in cells, to the nearest cell with a positive weight. It is infinite if all weights are null.
+     */
+    inline void gap_distances(const std::vector<double>& weights, unsigned int width, unsigned int height,
+			      std::vector<double>& dist) {
+      double inf = std::numeric_limits<double>::infinity();
+      dist.resize(weights.size());
+      for(std::size_t c = 0; c < weights.size(); ++c) dist[c] = weights[c] > 0 ? 0 : inf;
+      auto relax = [&dist, width, height](unsigned int i, unsigned int j, int di, int dj, double cost) {
+	int a = (int)i + di, b = (int)j + dj;
+	if(a < 0 || b < 0 || a >= (int)height || b >= (int)width) return;
+	double& d = dist[i*width + j];
+	d = std::min(d, dist[a*width + b] + cost);
+      };
+      for(unsigned int i = 0; i < height; ++i)
+	for(unsigned int j = 0; j < width; ++j) {
+	  relax(i, j, -1, -1, 4); relax(i, j, -1, 0, 3); relax(i, j, -1, 1, 4); relax(i, j, 0, -1, 3);
+	}
+      for(unsigned int i = height; i-- > 0;)
+	for(unsigned int j = width; j-- > 0;) {
+	  relax(i, j, 1, 1, 4); relax(i, j, 1, 0, 3); relax(i, j, 1, -1, 4); relax(i, j, 0, 1, 3);
+	}
+      for(auto& d : dist) d /= 3;
+    }
+
+    /**
+     * This fills the cells whose weight is lower than 1 with the pull-push algorithm: values are averaged at coarser and coarser resolutions, and the holes are filled with the bilinear interpolation of the next coarser level. Cells remain NaN if there is no data at all, or if they are farther than max_gap cells from any cell with a positive weight.
+     * @param values The values of the cells (row by row).
+     * @param weights The confidence in each value, in [0,1] (0 for empty cells).
+     * @param max_gap The distance, in cells, up to which empty cells are filled. By default, all of them are.
+     */
+    inline void pull_push(std::vector<double>& values, std::vector<double>& weights,
+			  unsigned int width, unsigned int height,
+			  double max_gap = std::numeric_limits<double>::infinity()) {
+      if(width == 0 || height == 0) return;
+
+      std::vector<double> dist;
+      if(max_gap < std::numeric_limits<double>::infinity())
+	gap_distances(weights, width, height, dist);
+	
+      // Pull
+      std::vector<std::vector<double>> vals(1), wgts(1);
+      std::vector<std::pair<unsigned int, unsigned int>> sizes(1, {width, height});
+      std::swap(vals[0], values);
+      std::swap(wgts[0], weights);
+      while(sizes.back().first > 1 || sizes.back().second > 1) {
+	unsigned int fw = sizes.back().first;
+	unsigned int fh = sizes.back().second;
+	unsigned int cw = (fw + 1)/2;
+	unsigned int ch = (fh + 1)/2;
+	vals.emplace_back(cw*ch, 0);
+	wgts.emplace_back(cw*ch, 0);
+	sizes.push_back({cw, ch});
+	auto& fv = vals[vals.size()-2]; auto& fwg = wgts[wgts.size()-2];
+	auto& cv = vals.back();         auto& cwg = wgts.back();
+	internal::parallel_for(ch, internal::grain_for(4*cw),
+			       [&, fw, fh, cw](unsigned int, std::size_t first, std::size_t last) {
+				 for(std::size_t i = first; i < last; ++i)
+				   for(unsigned int j = 0; j < cw; ++j) {
+				     double w = 0, v = 0;
+				     for(unsigned int a = 2*i; a < std::min((unsigned int)(2*i+2), fh); ++a)
+				       for(unsigned int b = 2*j; b < std::min(2*j+2, fw); ++b) {
+					 double wi = fwg[a*fw + b];
+					 if(wi > 0) {w += wi; v += wi*fv[a*fw + b];}
+				       }
+				     cv[i*cw + j]  = w > 0 ? v/w : 0;
+				     cwg[i*cw + j] = std::min(w, 1.0);
+				   }
+			       });
+      }
+
+      if(wgts.back()[0] == 0) {
+	std::fill(vals[0].begin(), vals[0].end(), std::nan(""));
+	std::fill(wgts[0].begin(), wgts[0].end(), 0);
+      }
+      else
+	// Push
+	for(unsigned int l = vals.size() - 1; l > 0; --l) {
+	  unsigned int fw = sizes[l-1].first;
+	  unsigned int fh = sizes[l-1].second;
+	  unsigned int cw = sizes[l].first;
+	  unsigned int ch = sizes[l].second;
+	  auto& fv = vals[l-1]; auto& fwg = wgts[l-1];
+	  auto& cv = vals[l];
+	  internal::parallel_for(fh, internal::grain_for(fw),
+				 [&, fw, cw, ch](unsigned int, std::size_t first, std::size_t last) {
+				   for(std::size_t i = first; i < last; ++i) {
+				     double y  = std::min(std::max(.5*i - .25, 0.), ch - 1.);
+				     unsigned int i0 = (unsigned int)y;
+				     unsigned int i1 = std::min(i0 + 1, ch - 1);
+				     double ty = y - i0;
+				     for(unsigned int j = 0; j < fw; ++j) {
+				       double& w = fwg[i*fw + j];
+				       if(w >= 1) continue;
+				       double x  = std::min(std::max(.5*j - .25, 0.), cw - 1.);
+				       unsigned int j0 = (unsigned int)x;
+				       unsigned int j1 = std::min(j0 + 1, cw - 1);
+				       double tx = x - j0;
+				       double parent = (1-ty)*((1-tx)*cv[i0*cw + j0] + tx*cv[i0*cw + j1])
+					 +                 ty *((1-tx)*cv[i1*cw + j0] + tx*cv[i1*cw + j1]);
+				       double& v = fv[i*fw + j];
+				       v = w*v + (1-w)*parent;
+				       w = 1;
+				     }
+				   }
+				 });
+	}
+      
+      std::swap(vals[0], values);
+      std::swap(wgts[0], weights);
+
+      for(std::size_t c = 0; c < dist.size(); ++c)
+	if(dist[c] > max_gap) {
+	  values[c]  = std::nan("");
+	  weights[c] = 0;
+	}
+    }
+
+    /**
+     * This interpolates the scattered values on the frame: cells are the average of the values they contain, empty cells are filled by pull_push. The filling is restricted to the cells closer to a sample than max_gap times the average spacing of the samples (the square root of the number of cells per occupied cell), so that the area far outside the samples is left empty (NaN). An infinite max_gap fills the whole frame.
+     */
+    inline void rasterize(const std::vector<ValueAt>& points, const Frame& frame, std::vector<double>& values,
+			  double max_gap = 2) {
+      std::vector<double> acc;
+      splat<1>(points.begin(), points.end(), frame,
+	       [](const ValueAt& v, double* values) {values[0] = v.value;},
+	       acc);
+      std::vector<double> weights(frame.size());
+      values.resize(frame.size());
+      for(unsigned int c = 0; c < frame.size(); ++c) {
+	double count = acc[2*c];
+	weights[c] = count > 0 ? 1 : 0;
+	values[c]  = count > 0 ? acc[2*c+1]/count : 0;
+      }
+      double occupied = std::count(weights.begin(), weights.end(), 1.0);
+      double spacing  = occupied > 0 ? std::sqrt(frame.size()/occupied) : 0;
+      pull_push(values, weights, frame.width, frame.height, max_gap*spacing);
+    }
+
+    /**
+     * This computes the bin of a value for nb bins regularly spread over [min,max[. The reciprocal scale is precomputed, and values out of range are mapped to nb.
+     */
+    struct Index1d {
+      double min, max, scale;
+      unsigned int nb;
+      Index1d(double min, double max, unsigned int nb) : min(min), max(max), scale(nb/(max - min)), nb(nb) {}
+      unsigned int operator()(double x) const {
+	if(!(x >= min && x < max)) return nb;
+	return std::min((unsigned int)((x - min)*scale), nb - 1);
+      }
+    };
+
+    /**
+     * This is the 2D version of Index1d, bins are numbered row by row. Points out of range are mapped to nbx*nby.
+     */
+    struct Index2d {
+      Index1d x, y;
+      Index2d(double xmin, double xmax, unsigned int nbx,
+	      double ymin, double ymax, unsigned int nby) : x(xmin, xmax, nbx), y(ymin, ymax, nby) {}
+      unsigned int operator()(const Point& pt) const {
+	unsigned int bx = x(pt.x);
+	unsigned int by = y(pt.y);
+	return (bx < x.nb && by < y.nb) ? bx + by*x.nb : x.nb*y.nb;
+      }
+    };
+
+    /**
+     * This computes the hexagonal cell of a point, for a lattice spanning [xmin,xmax[ x [ymin,ymax[ with nx cells along x and ny cells along y. The lattice is the one of matplotlib's hexbin: it is the union of a (nx+1) x (ny+1) rectangular grid of centers and of a nx x ny grid shifted by half a cell. Cells of the first grid are numbered row by row first, followed by the ones of the second grid. Points out of range are mapped to size().
+     */
+    struct HexIndex {
+      double xmin, xmax, ymin, ymax, xscale, yscale;
+      unsigned int nx, ny;
+      HexIndex(double xmin, double xmax, unsigned int nx,
+	       double ymin, double ymax, unsigned int ny)
+	: xmin(xmin), xmax(xmax), ymin(ymin), ymax(ymax),
+	  xscale(nx/(xmax - xmin)), yscale(ny/(ymax - ymin)),
+	  nx(nx), ny(ny) {}
+      
+      unsigned int size() const {return (nx+1)*(ny+1) + nx*ny;}
+      
+      unsigned int operator()(const Point& pt) const {
+	if(!(pt.x >= xmin && pt.x < xmax && pt.y >= ymin && pt.y < ymax))
+	  return size();
+	double x   = (pt.x - xmin)*xscale;
+	double y   = (pt.y - ymin)*yscale;
+	double ix1 = std::round(x), iy1 = std::round(y);
+	double ix2 = std::floor(x), iy2 = std::floor(y);
+	double d1  = (x - ix1)*(x - ix1) + 3*(y - iy1)*(y - iy1);
+	double d2  = (x - ix2 - .5)*(x - ix2 - .5) + 3*(y - iy2 - .5)*(y - iy2 - .5);
+	if(d1 < d2)
+	  return std::min((unsigned int)ix1, nx) + std::min((unsigned int)iy1, ny)*(nx+1);
+	return (nx+1)*(ny+1) + std::min((unsigned int)ix2, nx-1) + std::min((unsigned int)iy2, ny-1)*nx;
+      }
+    };
+
+    /**
+     * This adds to hits (of size nb_bins) the number of items in [begin, end) falling in each bin, index(item) being the bin of an item (nb_bins for out of range items).
+     *
+     * With random access iterators, the items are split in chunks handled in parallel, each one counting in a private array that is reduced afterwards. Within a chunk, the indices of a block of items are computed first, in a loop without dependencies, and the counts are incremented afterwards. Out of range items are counted in an extra bin, which avoids a test in the increment loop. Other iterators are read once, sequentially.
+     */
+    template<typename IT, typename INDEX, typename COUNT>
+    void histogram(IT begin, IT end, unsigned int nb_bins, const INDEX& index, std::vector<COUNT>& hits) {
+      hits.resize(nb_bins, 0);
+      if constexpr(!internal::random_access<IT>) {
+	for(; begin != end; ++begin) {
+	  unsigned int b = index(*begin);
+	  if(b < nb_bins) ++hits[b];
+	}
+      }
+      else {
+	constexpr unsigned int block = 256;
+	std::size_t size  = std::distance(begin, end);
+	std::size_t grain = std::max<std::size_t>(4096, nb_bins);
+	unsigned int nb   = internal::nb_chunks(size, grain);
+	std::vector<std::vector<unsigned long>> privates(nb, std::vector<unsigned long>(nb_bins + 1, 0));
+
+	internal::parallel_for(size, grain,
+			       [&privates, &index, begin](unsigned int chunk, std::size_t first, std::size_t last) {
+				 unsigned long* counts = privates[chunk].data();
+				 unsigned int idx[block];
+				 auto it = begin + first;
+				 for(std::size_t b = first; b < last; b += block) {
+				   unsigned int n = (unsigned int)std::min<std::size_t>(block, last - b);
+				   for(unsigned int i = 0; i < n; ++i, ++it)
+				     idx[i] = index(*it);
+				   for(unsigned int i = 0; i < n; ++i)
+				     ++counts[idx[i]];
+				 }
+			       });
+
+	for(auto& p : privates)
+	  for(unsigned int b = 0; b < nb_bins; ++b)
+	    hits[b] += p[b];
+      }
+    }
+
+    /**
+     * This reduces a polyline whose points are sorted by increasing x, for a display nb_columns pixels wide. In each column, the first and last points are kept, as well as the ones with the minimal and maximal y, in their original order. Drawing the result lights the same pixels as drawing the whole polyline, spikes included (this is known as M4 aggregation).
+     */
+    inline void minmax_decimation(const std::vector<Point>& points, unsigned int nb_columns, std::vector<Point>& res) {
+      res.clear();
+      std::size_t size = points.size();
+      if(size <= 4*std::size_t(nb_columns) || nb_columns == 0) {
+	res = points;
+	return;
+      }
+      double xmin  = points.front().x;
+      double xmax  = points.back().x;
+      double scale = xmax > xmin ? nb_columns/(xmax - xmin) : 0;
+
+      // Columns are computed by blocks, in a loop without dependencies.
+      constexpr std::size_t block = 256;
+      unsigned int cols[block];
+      std::size_t first = 0, imin = 0, imax = 0;
+      unsigned int current = 0;
+      auto flush = [&points, &res, &first, &imin, &imax](std::size_t last) {
+	std::size_t idx[4] = {first, std::min(imin, imax), std::max(imin, imax), last};
+	for(unsigned int k = 0; k < 4; ++k)
+	  if(k == 0 || idx[k] != idx[k-1])
+	    res.push_back(points[idx[k]]);
+      };
+      
+      for(std::size_t start = 0; start < size; start += block) {
+	std::size_t nb = std::min(block, size - start);
+	for(std::size_t i = 0; i < nb; ++i)
+	  cols[i] = std::min((unsigned int)(std::max(points[start + i].x - xmin, 0.)*scale), nb_columns - 1);
+	for(std::size_t i = 0; i < nb; ++i) {
+	  std::size_t idx = start + i;
+	  if(idx == 0 || cols[i] != current) {
+	    if(idx != 0) flush(idx - 1);
+	    current = cols[i];
+	    first = imin = imax = idx;
+	  }
+	  else {
+	    if(points[idx].y < points[imin].y) imin = idx;
+	    if(points[idx].y > points[imax].y) imax = idx;
+	  }
+	}
+      }
+      flush(size - 1);
+    }
+
+    /**
+     * This reduces a polyline whose points are sorted by increasing x to nb points, with the Largest-Triangle-Three-Buckets algorithm (S. Steinarsson, 2013). The first and last points are kept, the others are split in nb-2 buckets, and the point of each bucket forming the largest triangle with the previously kept point and the average of the next bucket is kept.
+     */
+    inline void lttb_decimation(const std::vector<Point>& points, unsigned int nb, std::vector<Point>& res) {
+      res.clear();
+      std::size_t size = points.size();
+      if(nb >= size || nb < 3) {
+	res = points;
+	return;
+      }
+      double every = (size - 2)/double(nb - 2);
+      std::size_t a = 0;
+      res.push_back(points[0]);
+      for(unsigned int i = 0; i < nb - 2; ++i) {
+	std::size_t avg_begin = std::size_t((i + 1)*every) + 1;
+	std::size_t avg_end   = std::min(std::size_t((i + 2)*every) + 1, size);
+	double avg_x = 0, avg_y = 0;
+	for(std::size_t j = avg_begin; j < avg_end; ++j) {
+	  avg_x += points[j].x;
+	  avg_y += points[j].y;
+	}
+	avg_x /= avg_end - avg_begin;
+	avg_y /= avg_end - avg_begin;
+
+	std::size_t begin = std::size_t(i*every) + 1;
+	std::size_t end   = std::size_t((i + 1)*every) + 1;
+	double ax = points[a].x, ay = points[a].y;
+	double max_area = -1;
+	std::size_t next = begin;
+	for(std::size_t j = begin; j < end; ++j) {
+	  // Twice the area, the factor does not change the max.
+	  double area = std::abs((ax - avg_x)*(points[j].y - ay) - (ax - points[j].x)*(avg_y - ay));
+	  if(area > max_area) {
+	    max_area = area;
+	    next = j;
+	  }
+	}
+	res.push_back(points[next]);
+	a = next;
+      }
+      res.push_back(points[size - 1]);
+    }
+
+    /**
+     * This calls f(first, last) for each run [first,last) of the polyline that contains no NaN point. NaN points are used by matplotlib to break lines.
+     */
+    template<typename F>
+    void for_each_run(const std::vector<Point>& points, const F& f) {
+      std::size_t size = points.size();
+      std::size_t first = 0;
+      while(first < size) {
+	if(std::isnan(points[first].x) || std::isnan(points[first].y)) {
+	  ++first;
+	  continue;
+	}
+	std::size_t last = first + 1;
+	while(last < size && !std::isnan(points[last].x) && !std::isnan(points[last].y)) ++last;
+	f(first, last);
+	first = last;
+      }
+    }
+
+    /**
+     * This simplifies a polyline with the Douglas-Peucker algorithm: a vertex is removed when it lies closer than tolerance to the segment joining the kept vertices around it. Distances are computed once x and y are divided by xscale and yscale, so that with the data units per pixel as scales, the tolerance is expressed in pixels. The indices of the kept vertices are written into kept, in increasing order. NaN points are kept, they break the polyline.
+     */
+    inline void douglas_peucker(const std::vector<Point>& points, double xscale, double yscale, double tolerance,
+				std::vector<std::size_t>& kept) {
+      std::vector<char> keep(points.size(), 1);
+      std::vector<std::pair<std::size_t, std::size_t>> stack;
+      double tol2 = tolerance*tolerance;
+      for_each_run(points, [&](std::size_t first, std::size_t last) {
+	  // The recursion is managed with a stack, polylines may be huge.
+	  stack.push_back({first, last - 1});
+	  while(!stack.empty()) {
+	    auto ab = stack.back();
+	    stack.pop_back();
+	    std::size_t a = ab.first, b = ab.second;
+	    if(b <= a + 1) continue;
+	    double ax = points[a].x/xscale, ay = points[a].y/yscale;
+	    double ux = points[b].x/xscale - ax, uy = points[b].y/yscale - ay;
+	    double len2 = ux*ux + uy*uy;
+	    double dmax = -1;
+	    std::size_t imax = a;
+	    for(std::size_t i = a + 1; i < b; ++i) {
+	      double px = points[i].x/xscale - ax, py = points[i].y/yscale - ay;
+	      double d2;
+	      if(len2 == 0)
+		d2 = px*px + py*py;
+	      else {
+		double cross = ux*py - uy*px;
+		d2 = cross*cross/len2;
+	      }
+	      if(d2 > dmax) {
+		dmax = d2;
+		imax = i;
+	      }
+	    }
+	    if(dmax < tol2)
+	      std::fill(keep.begin() + a + 1, keep.begin() + b, 0);
+	    else {
+	      stack.push_back({a, imax});
+	      stack.push_back({imax, b});
+	    }
+	  }
+	});
+      kept.clear();
+      for(std::size_t i = 0; i < keep.size(); ++i)
+	if(keep[i]) kept.push_back(i);
+    }
+
+    /**
+     * This simplifies a polyline with the Visvalingam-Whyatt algorithm: the vertex forming the smallest triangle with its neighbours is removed, as long as this area is lower than tolerance². Areas are computed once x and y are divided by xscale and yscale, as for douglas_peucker. The indices of the kept vertices are written into kept, in increasing order. NaN points are kept, they break the polyline.
+     */
+    inline void visvalingam(const std::vector<Point>& points, double xscale, double yscale, double tolerance,
+			    std::vector<std::size_t>& kept) {
+      std::size_t size = points.size();
+      std::vector<char> keep(size, 1);
+      std::vector<std::size_t> prev(size), next(size);
+      std::vector<double> area(size);
+      double threshold = tolerance*tolerance;
+      auto triangle = [&points, xscale, yscale](std::size_t a, std::size_t b, std::size_t c) {
+	double ux = (points[a].x - points[b].x)/xscale, uy = (points[a].y - points[b].y)/yscale;
+	double vx = (points[c].x - points[b].x)/xscale, vy = (points[c].y - points[b].y)/yscale;
+	return .5*std::abs(ux*vy - uy*vx);
+      };
+      
+      typedef std::pair<double, std::size_t> Entry;
+      std::vector<Entry> heap;
+      auto later = [](const Entry& a, const Entry& b) {return a.first > b.first;};
+      for_each_run(points, [&](std::size_t first, std::size_t last) {
+	  heap.clear();
+	  for(std::size_t i = first + 1; i + 1 < last; ++i) {
+	    prev[i] = i - 1;
+	    next[i] = i + 1;
+	    area[i] = triangle(i - 1, i, i + 1);
+	    heap.push_back({area[i], i});
+	  }
+	  std::make_heap(heap.begin(), heap.end(), later);
+	  while(!heap.empty()) {
+	    std::pop_heap(heap.begin(), heap.end(), later);
+	    Entry e = heap.back();
+	    heap.pop_back();
+	    std::size_t i = e.second;
+	    if(!keep[i] || e.first != area[i]) continue; // Outdated entry.
+	    if(e.first >= threshold) break;
+	    keep[i] = 0;
+	    std::size_t p = prev[i], n = next[i];
+	    // Areas of the neighbours never decrease below the removed
+	    // one, so that the removal order stays consistent.
+	    if(p != first) {
+	      next[p] = n;
+	      area[p] = std::max(triangle(prev[p], p, n), e.first);
+	      heap.push_back({area[p], p});
+	      std::push_heap(heap.begin(), heap.end(), later);
+	    }
+	    if(n != last - 1) {
+	      prev[n] = p;
+	      area[n] = std::max(triangle(p, n, next[n]), e.first);
+	      heap.push_back({area[n], n});
+	      std::push_heap(heap.begin(), heap.end(), later);
+	    }
+	  }
+	});
+      kept.clear();
+      for(std::size_t i = 0; i < size; ++i)
+	if(keep[i]) kept.push_back(i);
+    }
+
+    /**
+     * This copies into res the items of [begin,end) for which keep(item) is true, in their original order. Chunks are filtered in parallel, and the results are concatenated.
+     */
+    template<typename IT, typename KEEP, typename T>
+    void select(IT begin, IT end, const KEEP& keep, std::vector<T>& res) {
+      std::size_t size = std::distance(begin, end);
+      unsigned int nb = internal::nb_chunks(size, 4096);
+      std::vector<std::vector<T>> parts(nb);
+      internal::parallel_for(size, 4096,
+			     [&parts, &keep, begin](unsigned int chunk, std::size_t first, std::size_t last) {
+			       auto& part = parts[chunk];
+			       for(auto it = begin + first, stop = begin + last; it != stop; ++it)
+				 if(keep(*it)) part.push_back(*it);
+			     });
+      res.clear();
+      for(auto& part : parts)
+	res.insert(res.end(), part.begin(), part.end());
+    }
+
+    /**
+     * This is a uniform grid over a set of points, which is built once. It enables to retrieve the points lying in a box without scanning all of them: only the cells overlapping the box are visited, and only the ones across its border need their points to be tested. Points with non finite coordinates are not indexed.
+     */
+    class PointIndex {
+    private:
+      Frame frame;
+      double xscale, yscale;
+      std::vector<std::size_t> starts; // points of cell c are sorted[starts[c]] ... sorted[starts[c+1]-1]
+      std::vector<Point> sorted;
+
+      unsigned int cell_of(const Point& pt) const {
+	if(!(pt.x >= frame.xmin && pt.x <= frame.xmax && pt.y >= frame.ymin && pt.y <= frame.ymax))
+	  return frame.size();
+	unsigned int col = std::min((unsigned int)((pt.x - frame.xmin)*xscale), frame.width  - 1);
+	unsigned int row = std::min((unsigned int)((pt.y - frame.ymin)*yscale), frame.height - 1);
+	return col + row*frame.width;
+      }
+
+      // This is the range of cells [first,last] overlapping [min,max], along an axis.
+      static void cells(double min, double max, double origin, double scale, unsigned int nb,
+			unsigned int& first, unsigned int& last) {
+	first = (unsigned int)std::min(std::max(std::floor((min - origin)*scale), 0.), nb - 1.);
+	last  = (unsigned int)std::min(std::max(std::floor((max - origin)*scale), 0.), nb - 1.);
+      }
+      
+    public:
+
+      /**
+       * @param points_per_cell The average number of points in a cell, which sets the grid resolution.
+       */
+      PointIndex(const std::vector<Point>& points, unsigned int points_per_cell = 16) {
+	unsigned int side = std::max(1u, (unsigned int)std::sqrt(points.size()/double(std::max(1u, points_per_cell))));
+	frame  = bounding_frame(points.begin(), points.end(), side, side);
+	xscale = side/(frame.xmax - frame.xmin);
+	yscale = side/(frame.ymax - frame.ymin);
+
+	// This is a counting sort of the points by cell.
+	std::vector<std::size_t> hits(frame.size(), 0);
+	histogram(points.begin(), points.end(), frame.size(), [this](const Point& pt) {return cell_of(pt);}, hits);
+	starts.assign(frame.size() + 1, 0);
+	for(unsigned int c = 0; c < frame.size(); ++c)
+	  starts[c+1] = starts[c] + hits[c];
+	sorted.resize(starts.back());
+	std::vector<std::size_t> next(starts.begin(), starts.end() - 1);
+	for(auto& pt : points) {
+	  unsigned int c = cell_of(pt);
+	  if(c < frame.size()) sorted[next[c]++] = pt;
+	}
+      }
+
+      PointIndex(const PointIndex&)            = default;
+      PointIndex& operator=(const PointIndex&) = default;
+
+      /**
+       * These are the indexed points, sorted by cell.
+       */
+      const std::vector<Point>& points() const {return sorted;}
+
+      /**
+       * This sets res to the points in [xmin,xmax]x[ymin,ymax].
+       */
+      void query(double xmin, double xmax, double ymin, double ymax, std::vector<Point>& res) const {
+	res.clear();
+	if(sorted.size() == 0 || xmax < frame.xmin || xmin > frame.xmax || ymax < frame.ymin || ymin > frame.ymax)
+	  return;
+	unsigned int col_first, col_last, row_first, row_last;
+	cells(xmin, xmax, frame.xmin, xscale, frame.width,  col_first, col_last);
+	cells(ymin, ymax, frame.ymin, yscale, frame.height, row_first, row_last);
+	for(unsigned int row = row_first; row <= row_last; ++row) {
+	  bool row_inside = row > row_first && row < row_last;
+	  for(unsigned int col = col_first; col <= col_last; ++col) {
+	    unsigned int c = col + row*frame.width;
+	    auto first = sorted.begin() + starts[c];
+	    auto last  = sorted.begin() + starts[c+1];
+	    if(row_inside && col > col_first && col < col_last)
+	      res.insert(res.end(), first, last);
+	    else
+	      for(auto it = first; it != last; ++it)
+		if(it->x >= xmin && it->x <= xmax && it->y >= ymin && it->y <= ymax)
+		  res.push_back(*it);
+	  }
+	}
+      }
+    };
+
+    /**
+     * This is a min/max pyramid over a static polyline whose points are sorted by increasing x. It is built once, and then gives the M4 reduction (see minmax_decimation) of any x window at a cost that depends on the number of pixel columns rather than on the number of points in the window.
+     *
+     * Level k stores, for each block of base*2^k consecutive points, the indices of its lowest and highest points. A query picks the coarsest level that still has 4 blocks per pixel column in the window, and reduces the first, last, lowest and highest points of these blocks.
+     */
+    class MinMaxPyramid {
+    private:
+      typedef std::pair<std::size_t, std::size_t> Extrema; // indices of the lowest and highest points.
+      std::vector<Point> samples;
+      unsigned int base;
+      std::vector<std::vector<Extrema>> levels;
+
+      Extrema merge(const Extrema& a, const Extrema& b) const {
+	return {samples[b.first].y  < samples[a.first].y  ? b.first  : a.first,
+		samples[b.second].y > samples[a.second].y ? b.second : a.second};
+      }
+      
+    public:
+
+      MinMaxPyramid(const std::vector<Point>& points, unsigned int base = 8)
+	: samples(points), base(std::max(1u, base)), levels() {
+	std::size_t size = samples.size();
+	std::size_t nb   = (size + this->base - 1)/this->base;
+	if(nb < 2) return;
+
+	// Blocks of a level are computed in parallel.
+	levels.emplace_back(nb);
+	internal::parallel_for(nb, 1024,
+			       [this, size](unsigned int, std::size_t first, std::size_t last) {
+				 for(std::size_t b = first; b < last; ++b) {
+				   std::size_t begin = b*this->base, end = std::min(begin + this->base, size);
+				   Extrema e = {begin, begin};
+				   for(std::size_t i = begin + 1; i < end; ++i)
+				     e = merge(e, {i, i});
+				   levels[0][b] = e;
+				 }
+			       });
+	while(levels.back().size() > 1) {
+	  std::size_t nb = (levels.back().size() + 1)/2;
+	  levels.emplace_back(nb);
+	  auto& src = levels[levels.size() - 2];
+	  auto& dst = levels.back();
+	  internal::parallel_for(nb, 1024,
+				 [this, &src, &dst](unsigned int, std::size_t first, std::size_t last) {
+				   for(std::size_t b = first; b < last; ++b)
+				     dst[b] = 2*b+1 < src.size() ? merge(src[2*b], src[2*b+1]) : src[2*b];
+				 });
+	}
+      }
+
+      MinMaxPyramid(const MinMaxPyramid&)            = default;
+      MinMaxPyramid& operator=(const MinMaxPyramid&) = default;
+
+      const std::vector<Point>& points() const {return samples;}
+
+      /**
+       * This sets res to the reduction, for nb_columns pixel columns, of the points in [xmin,xmax] (and of their neighbours outside, so that the line reaches the borders).
+       */
+      void query(double xmin, double xmax, unsigned int nb_columns, std::vector<Point>& res) const {
+	res.clear();
+	auto first = std::lower_bound(samples.begin(), samples.end(), xmin, [](const Point& pt, double x) {return pt.x < x;});
+	auto last  = std::upper_bound(samples.begin(), samples.end(), xmax, [](double x, const Point& pt) {return x < pt.x;});
+	if(first != samples.begin()) --first;
+	if(last  != samples.end())   ++last;
+	std::size_t i0 = first - samples.begin(), i1 = last - samples.begin();
+	std::size_t count = i1 - i0;
+	if(count <= 4*std::size_t(nb_columns)) {
+	  res.assign(first, last);
+	  return;
+	}
+
+	// Level k has blocks of base*2^k points.
+	int level = -1;
+	while(level + 1 < (int)levels.size() && count/(std::size_t(base) << (level + 1)) >= 4*std::size_t(nb_columns)) ++level;
+	std::vector<Point> reps;
+	if(level < 0) 
+	  reps.assign(first, last);
+	else {
+	  std::size_t block = std::size_t(base) << level;
+	  std::size_t b0 = (i0 + block - 1)/block, b1 = i1/block;
+	  for(std::size_t i = i0; i < std::min(b0*block, i1); ++i) reps.push_back(samples[i]);
+	  for(std::size_t b = b0; b < b1; ++b) {
+	    auto& e = levels[level][b];
+	    std::size_t idx[4] = {b*block, std::min(e.first, e.second), std::max(e.first, e.second), std::min((b+1)*block, samples.size()) - 1};
+	    for(unsigned int k = 0; k < 4; ++k)
+	      if(k == 0 || idx[k] != idx[k-1])
+		reps.push_back(samples[idx[k]]);
+	  }
+	  for(std::size_t i = std::max(b1*block, b0*block); i < i1; ++i) reps.push_back(samples[i]);
+	}
+	minmax_decimation(reps, nb_columns, res);
+      }
+    };
+
+    /**
+     * This computes in place the discrete Fourier transform of data, whose size has to be a power of 2, with the iterative radix-2 Cooley-Tukey algorithm.
+     */
+    inline void fft(std::vector<std::complex<double>>& data) {
+      std::size_t n = data.size();
+      if(n < 2) return;
+      
+      // Bit-reversal permutation.
+      for(std::size_t i = 1, j = 0; i < n; ++i) {
+	std::size_t bit = n >> 1;
+	for(; j & bit; bit >>= 1) j ^= bit;
+	j ^= bit;
+	if(i < j) std::swap(data[i], data[j]);
+      }
+
+      // Twiddles are computed once, rather than accumulated by products.
+      std::vector<std::complex<double>> twiddles(n/2);
+      for(std::size_t k = 0; k < n/2; ++k)
+	twiddles[k] = std::polar(1., -2*M_PI*k/n);
+      
+      for(std::size_t len = 2; len <= n; len <<= 1) {
+	std::size_t half = len/2;
+	std::size_t step = n/len;
+	for(std::size_t i = 0; i < n; i += len)
+	  for(std::size_t j = 0; j < half; ++j) {
+	    auto u = data[i + j];
+	    auto v = data[i + j + half]*twiddles[j*step];
+	    data[i + j]        = u + v;
+	    data[i + j + half] = u - v;
+	  }
+      }
+    }
+
+    /**
+     * This computes the n/2+1 first coefficients of the discrete Fourier transform of the n real samples, n being a power of 2 (the other ones are their conjugates). The samples are packed into a complex sequence of size n/2, whose transform is then split.
+     */
+    inline void real_fft(const std::vector<double>& samples, std::vector<std::complex<double>>& res) {
+      std::size_t n = samples.size();
+      std::size_t m = n/2;
+      res.resize(m + 1);
+      if(n < 2) {
+	if(n == 1) res[0] = samples[0];
+	return;
+      }
+      std::vector<std::complex<double>> z(m);
+      for(std::size_t k = 0; k < m; ++k)
+	z[k] = {samples[2*k], samples[2*k + 1]};
+      fft(z);
+      for(std::size_t k = 0; k <= m; ++k) {
+	auto zk  = z[k % m];
+	auto zmk = std::conj(z[(m - k) % m]);
+	auto even = .5*(zk + zmk);
+	auto odd  = std::complex<double>(0, -.5)*(zk - zmk);
+	res[k] = even + std::polar(1., -2*M_PI*k/n)*odd;
+      }
+    }
+
+    /**
+     * This is the bandwidth of a Gaussian kernel density estimation of the values, from the rule of thumb of Silverman: 0.9 min(sigma, IQR/1.34) n^(-1/5). proj(item) gives the value of an item. For one of the axes of a 2D estimation (dimension = 2), this is the rule of Scott, min(sigma, IQR/1.34) n^(-1/6).
+     */
+    template<typename IT, typename PROJ>
+    double silverman_bandwidth(IT begin, IT end, const PROJ& proj, unsigned int dimension = 1) {
+      std::vector<double> values;
+      for(auto it = begin; it != end; ++it) values.push_back(proj(*it));
+      std::size_t n = values.size();
+      if(n < 2) return 1;
+      double mean = 0;
+      for(auto v : values) mean += v;
+      mean /= n;
+      double var = 0;
+      for(auto v : values) var += (v - mean)*(v - mean);
+      double sigma = std::sqrt(var/(n - 1));
+      std::nth_element(values.begin(), values.begin() + n/4, values.end());
+      double q1 = values[n/4];
+      std::nth_element(values.begin(), values.begin() + (3*n)/4, values.end());
+      double q3 = values[(3*n)/4];
+      double spread = sigma;
+      if(q3 > q1) spread = std::min(spread, (q3 - q1)/1.34);
+      if(!(spread > 0)) spread = std::max(std::abs(mean), 1.)*1e-3;
+      if(dimension == 1) return .9*spread*std::pow(n, -.2);
+      return spread*std::pow(n, -1./(dimension + 4));
+    }
+  }
+
+  namespace internal {
+
+    // This is a sampled Gaussian kernel of standard deviation h (in
+    // grid steps), truncated at 4h. It is normalized by its discrete
+    // sum, so that convolving keeps the total mass even when h is
+    // below a grid step.
+    inline std::vector<double> gaussian_kernel(double h) {
+      int r = std::max(1, int(std::ceil(4*h)));
+      std::vector<double> kernel(2*r + 1);
+      double sum = 0;
+      for(int j = -r; j <= r; ++j)
+	sum += kernel[j + r] = std::exp(-.5*j*j/(h*h));
+      for(auto& k : kernel) k /= sum;
+      return kernel;
+    }
+
+    // This convolves the lines of values (line l is made of the nb
+    // values data[l*line_stride + i*stride]) with the kernel, zero
+    // being assumed outside, in parallel over the lines.
+    inline void convolve(std::vector<double>& data, std::size_t nb_lines, std::size_t line_stride,
+			 std::size_t nb, std::size_t stride, const std::vector<double>& kernel) {
+      int r = kernel.size()/2;
+      internal::parallel_for(nb_lines, internal::grain_for(nb*kernel.size()),
+			     [&data, line_stride, nb, stride, &kernel, r](unsigned int, std::size_t first, std::size_t last) {
+			       std::vector<double> line(nb);
+			       for(std::size_t l = first; l < last; ++l) {
+				 auto start = data.begin() + l*line_stride;
+				 for(std::size_t i = 0; i < nb; ++i) line[i] = start[i*stride];
+				 for(std::size_t i = 0; i < nb; ++i) {
+				   double sum = 0;
+				   int lo = std::max(0, int(i) - r);
+				   int hi = std::min(int(nb) - 1, int(i) + r);
+				   for(int j = lo; j <= hi; ++j) sum += line[j]*kernel[j - int(i) + r];
+				   start[i*stride] = sum;
+				 }
+			       }
+			     });
+    }
+  }
+
+  namespace algo {
+
+    /**
+     * This chooses a grid for kde1d (or for an axis of kde2d) with the bandwidth h: at least nb points spanning the values enlarged by 3h. If the step of that grid exceeds h, as with heavy-tailed values, the span is restricted to the central 99% of the values (enlarged by 3h), and the number of points is raised, up to max_nb, so that the step gets down to h. Non finite values are ignored.
+     */
+    inline void kde_grid(std::vector<double> values, double h, unsigned int nb, unsigned int max_nb,
+			 double& min, double& max, unsigned int& nb_out) {
+      values.erase(std::remove_if(values.begin(), values.end(), [](double v) {return !std::isfinite(v);}), values.end());
+      nb_out = std::max(nb, 2u);
+      if(values.size() == 0 || !(h > 0)) {
+	min = 0;
+	max = 1;
+	return;
+      }
+      auto extrema = std::minmax_element(values.begin(), values.end());
+      min = *extrema.first  - 3*h;
+      max = *extrema.second + 3*h;
+      if((max - min)/(nb_out - 1) <= h) return;
+      std::size_t lo = values.size()/200, hi = values.size() - 1 - lo;
+      std::nth_element(values.begin(), values.begin() + lo, values.end());
+      min = values[lo] - 3*h;
+      std::nth_element(values.begin(), values.begin() + hi, values.end());
+      max = values[hi] + 3*h;
+      nb_out = (unsigned int)std::max<double>(nb_out, std::min<double>(max_nb, std::ceil((max - min)/h) + 1));
+    }
+
+    /**
+     * This estimates the density of the samples at the nb abscissas regularly spread over [xmin,xmax], with a Gaussian kernel of bandwidth h. The step of the grid should not exceed h (see kde_grid). The samples are linearly binned on the grid (in parallel), and the bins are convolved with the kernel, which costs O(samples + nb*h/step) rather than O(samples*nb).
+     */
+    template<typename IT, typename PROJ>
+    void kde1d(IT begin, IT end, const PROJ& proj, double h,
+	       double xmin, double xmax, unsigned int nb,
+	       std::vector<double>& density) {
+      density.assign(nb, 0);
+      std::size_t size = std::distance(begin, end);
+      if(nb < 2 || size == 0 || !(xmax > xmin) || !(h > 0)) return;
+      double step = (xmax - xmin)/(nb - 1);
+      std::vector<std::vector<double>> parts(internal::nb_chunks(size, 4096), std::vector<double>(nb, 0));
+      internal::parallel_for(size, 4096,
+			     [&parts, begin, &proj, xmin, step, nb](unsigned int chunk, std::size_t first, std::size_t last) {
+			       auto& bins = parts[chunk];
+			       for(auto it = begin + first, stop = begin + last; it != stop; ++it) {
+				 double pos = (proj(*it) - xmin)/step;
+				 if(!(pos >= 0) || pos > nb - 1) continue;
+				 std::size_t i = std::min(std::size_t(pos), std::size_t(nb - 2));
+				 double w = pos - i;
+				 bins[i]     += 1 - w;
+				 bins[i + 1] += w;
+			       }
+			     });
+      for(auto& bins : parts)
+	for(unsigned int i = 0; i < nb; ++i) density[i] += bins[i];
+      internal::convolve(density, 1, 0, nb, 1, internal::gaussian_kernel(h/step));
+      for(auto& d : density) d /= size*step;
+    }
+
+    /**
+     * This estimates the density of the points on the nb_x*nb_y grid regularly spread over [xmin,xmax]x[ymin,ymax] (row by row, y = ymin first), with a Gaussian product kernel of bandwidths hx and hy. The points are bilinearly binned (in parallel), and the grid is convolved by rows and then by columns.
+     */
+    template<typename IT>
+    void kde2d(IT begin, IT end, double hx, double hy,
+	       double xmin, double xmax, unsigned int nb_x,
+	       double ymin, double ymax, unsigned int nb_y,
+	       std::vector<double>& density) {
+      std::size_t nb = std::size_t(nb_x)*nb_y;
+      density.assign(nb, 0);
+      std::size_t size = std::distance(begin, end);
+      if(nb_x < 2 || nb_y < 2 || size == 0 || !(xmax > xmin) || !(ymax > ymin) || !(hx > 0) || !(hy > 0)) return;
+      double xstep = (xmax - xmin)/(nb_x - 1);
+      double ystep = (ymax - ymin)/(nb_y - 1);
+      std::vector<std::vector<double>> parts(internal::nb_chunks(size, 4096), std::vector<double>(nb, 0));
+      internal::parallel_for(size, 4096,
+			     [&parts, begin, xmin, xstep, nb_x, ymin, ystep, nb_y](unsigned int chunk, std::size_t first, std::size_t last) {
+			       auto& bins = parts[chunk];
+			       for(auto it = begin + first, stop = begin + last; it != stop; ++it) {
+				 const Point& pt = *it;
+				 double px = (pt.x - xmin)/xstep;
+				 double py = (pt.y - ymin)/ystep;
+				 if(!(px >= 0) || px > nb_x - 1 || !(py >= 0) || py > nb_y - 1) continue;
+				 std::size_t i = std::min(std::size_t(px), std::size_t(nb_x - 2));
+				 std::size_t j = std::min(std::size_t(py), std::size_t(nb_y - 2));
+				 double wx = px - i, wy = py - j;
+				 auto cell = bins.begin() + j*nb_x + i;
+				 cell[0]        += (1 - wx)*(1 - wy);
+				 cell[1]        += wx*(1 - wy);
+				 cell[nb_x]     += (1 - wx)*wy;
+				 cell[nb_x + 1] += wx*wy;
+			       }
+			     });
+      for(auto& bins : parts)
+	for(std::size_t c = 0; c < nb; ++c) density[c] += bins[c];
+      internal::convolve(density, nb_y, nb_x, nb_x, 1,    internal::gaussian_kernel(hx/xstep));
+      internal::convolve(density, nb_x, 1,    nb_y, nb_x, internal::gaussian_kernel(hy/ystep));
+      for(auto& d : density) d /= size*xstep*ystep;
+    }
+
+    /**
+     * This sorts [begin,end) in parallel: chunks are sorted by their own threads, and then merged pairwise, the merges of a pass being run in parallel as well.
+     */
+    template<typename IT>
+    void parallel_sort(IT begin, IT end) {
+      std::size_t size = std::distance(begin, end);
+      unsigned int nb = internal::nb_chunks(size, 1 << 16);
+      std::vector<std::size_t> bounds(nb + 1, size);
+      internal::parallel_for(size, 1 << 16,
+			     [&bounds, begin](unsigned int chunk, std::size_t first, std::size_t last) {
+			       bounds[chunk] = first;
+			       std::sort(begin + first, begin + last);
+			     });
+      while(bounds.size() > 2) {
+	std::size_t nb_runs = bounds.size() - 1;
+	internal::parallel_for(nb_runs/2, 1,
+			       [&bounds, begin](unsigned int, std::size_t first, std::size_t last) {
+				 for(std::size_t p = first; p < last; ++p)
+				   std::inplace_merge(begin + bounds[2*p], begin + bounds[2*p + 1], begin + bounds[2*p + 2]);
+			       });
+	std::vector<std::size_t> merged;
+	for(std::size_t r = 0; r < nb_runs; r += 2) merged.push_back(bounds[r]);
+	merged.push_back(size);
+	bounds = merged;
+      }
+    }
+
+    /**
+     * This reduces the empirical cumulative distribution function of the sorted values for a display of nb_columns x nb_rows pixels. Points (values[i], (i+1)/n) are kept for the ranks i regularly spread over the n values (one per row), and for the last rank below each of the nb_columns regular steps of the value range, so that the reduced curve is within a pixel of the full one in both directions. As the ECDF is a step function, each kept point is preceded by the corner (values[i], previous level), so that a polyline through the result draws horizontal and vertical segments. A first point (values[0], 0) starts the curve.
+     */
+    inline void ecdf_points(const std::vector<double>& values, unsigned int nb_columns, unsigned int nb_rows,
+			    std::vector<Point>& res) {
+      res.clear();
+      std::size_t n = values.size();
+      if(n == 0) return;
+      std::vector<std::size_t> ranks;
+      for(unsigned int k = 1; k <= nb_rows; ++k)
+	ranks.push_back(std::min(n - 1, std::size_t(std::ceil(double(k)*n/nb_rows)) - 1));
+      double lo = values.front(), hi = values.back();
+      for(unsigned int j = 0; j <= nb_columns; ++j) {
+	double x = lo + j*(hi - lo)/std::max(nb_columns, 1u);
+	auto it = std::upper_bound(values.begin(), values.end(), x);
+	if(it != values.begin()) ranks.push_back(std::distance(values.begin(), it) - 1);
+      }
+      ranks.push_back(0);
+      ranks.push_back(n - 1);
+      std::sort(ranks.begin(), ranks.end());
+      ranks.erase(std::unique(ranks.begin(), ranks.end()), ranks.end());
+      res.push_back({values.front(), 0});
+      for(auto i : ranks) {
+	if(res.back().x != values[i]) res.push_back({values[i], res.back().y});
+	res.push_back({values[i], (i + 1)/double(n)});
+      }
+    }
+
+    /**
+     * This samples y = f(x) over [xmin,xmax] for a line: starting from nb_initial regular intervals, the intervals whose midpoint is farther than tolerance (vertically) from their chord are bisected, at most max_depth times. Flat regions thus get few points, and sharp features many. At each pass, f is evaluated at all the midpoints, in parallel chunks scheduled dynamically when there are more than a chunk of them (small passes run in the calling thread), so f has to be thread-safe. This returns the number of evaluations.
+     */
+    template<typename F>
+    std::size_t adaptive_sampling(const F& f, double xmin, double xmax, double tolerance,
+				  std::vector<Point>& res,
+				  unsigned int nb_initial = 32, unsigned int max_depth = 10) {
+      nb_initial = std::max(nb_initial, 1u);
+      res.resize(nb_initial + 1);
+      internal::parallel_for_dynamic(res.size(), 64,
+				     [&res, &f, xmin, xmax, nb_initial](std::size_t first, std::size_t last) {
+				       for(std::size_t i = first; i < last; ++i) {
+					 double x = xmin + i*(xmax - xmin)/nb_initial;
+					 res[i] = {x, f(x)};
+				       }
+				     });
+      std::size_t nb_evals = res.size();
+      
+      std::vector<char> active(nb_initial, 1); // active[i] is for [res[i], res[i+1]].
+      std::vector<std::size_t> todo;
+      std::vector<Point> mids, next;
+      std::vector<char> next_active;
+      for(unsigned int depth = 0; depth < max_depth; ++depth) {
+	todo.clear();
+	for(std::size_t i = 0; i < active.size(); ++i)
+	  if(active[i]) todo.push_back(i);
+	if(todo.size() == 0) break;
+	mids.resize(todo.size());
+	internal::parallel_for_dynamic(todo.size(), 64,
+				       [&res, &f, &todo, &mids](std::size_t first, std::size_t last) {
+					 for(std::size_t k = first; k < last; ++k) {
+					   double x = .5*(res[todo[k]].x + res[todo[k] + 1].x);
+					   mids[k] = {x, f(x)};
+					 }
+				       });
+	nb_evals += todo.size();
+	
+	next.clear();
+	next_active.clear();
+	auto mid = mids.begin();
+	for(std::size_t i = 0; i < active.size(); ++i) {
+	  next.push_back(res[i]);
+	  bool split = false;
+	  if(active[i]) {
+	    double chord = .5*(res[i].y + res[i + 1].y);
+	    split = !(std::abs(mid->y - chord) <= tolerance); // NaN values are refined too.
+	    if(split) next.push_back(*mid);
+	    ++mid;
+	  }
+	  next_active.push_back(split);
+	  if(split) next_active.push_back(1);
+	}
+	next.push_back(res.back());
+	std::swap(res, next);
+	std::swap(active, next_active);
+      }
+      return nb_evals;
+    }
+  }
+
+  namespace internal {
+
+    // This refines the nb_x*nb_y grid z (row by row, y = ymin first)
+    // with a quadtree. known[c] tells whether f has been evaluated at
+    // node c, the other nodes are bilinearly interpolated.
+    template<typename F>
+    std::size_t adaptive_grid(const F& f,
+			      double xmin, double xmax, unsigned int nb_x,
+			      double ymin, double ymax, unsigned int nb_y,
+			      double tolerance, unsigned int coarse,
+			      std::vector<double>& z, std::vector<char>& known) {
+      struct Cell {unsigned int i0, i1, j0, j1;};
+      std::size_t nb = std::size_t(nb_x)*nb_y;
+      z.assign(nb, 0);
+      known.assign(nb, 0);
+      if(nb_x < 2 || nb_y < 2) return 0;
+      coarse = std::max(coarse, 1u);
+      double xstep = (xmax - xmin)/(nb_x - 1);
+      double ystep = (ymax - ymin)/(nb_y - 1);
+      
+      std::vector<std::size_t> nodes;
+      std::size_t nb_evals = 0;
+      // This evaluates the unknown nodes, in parallel when there are
+      // enough of them.
+      auto evaluate = [&]() {
+	std::sort(nodes.begin(), nodes.end());
+	nodes.erase(std::unique(nodes.begin(), nodes.end()), nodes.end());
+	internal::parallel_for_dynamic(nodes.size(), 64,
+				       [&](std::size_t first, std::size_t last) {
+					 for(std::size_t k = first; k < last; ++k) {
+					   std::size_t c = nodes[k];
+					   z[c] = f(xmin + (c % nb_x)*xstep, ymin + (c / nb_x)*ystep);
+					 }
+				       });
+	for(auto c : nodes) known[c] = 1;
+	nb_evals += nodes.size();
+	nodes.clear();
+      };
+      auto need = [&](unsigned int i, unsigned int j) {
+	std::size_t c = std::size_t(j)*nb_x + i;
+	if(!known[c]) nodes.push_back(c);
+      };
+      auto bilinear = [&](const Cell& cell, unsigned int i, unsigned int j) {
+	double u = cell.i1 == cell.i0 ? 0 : (i - cell.i0)/double(cell.i1 - cell.i0);
+	double v = cell.j1 == cell.j0 ? 0 : (j - cell.j0)/double(cell.j1 - cell.j0);
+	auto at = [&](unsigned int ii, unsigned int jj) {return z[std::size_t(jj)*nb_x + ii];};
+	return (1 - u)*(1 - v)*at(cell.i0, cell.j0) + u*(1 - v)*at(cell.i1, cell.j0)
+	  +    (1 - u)*v*at(cell.i0, cell.j1)       + u*v*at(cell.i1, cell.j1);
+      };
+
+      // The coarse cells.
+      std::vector<Cell> cells, leaves, next;
+      for(unsigned int j = 0; j + 1 < nb_y; j += coarse)
+	for(unsigned int i = 0; i + 1 < nb_x; i += coarse)
+	  cells.push_back({i, std::min(i + coarse, nb_x - 1), j, std::min(j + coarse, nb_y - 1)});
+      for(auto& cell : cells) {
+	need(cell.i0, cell.j0); need(cell.i1, cell.j0);
+	need(cell.i0, cell.j1); need(cell.i1, cell.j1);
+      }
+      evaluate();
+
+      // Cells are split while the center or the middles of the edges
+      // are not well interpolated from the corners.
+      while(cells.size() != 0) {
+	for(auto& cell : cells) {
+	  unsigned int im = (cell.i0 + cell.i1)/2, jm = (cell.j0 + cell.j1)/2;
+	  need(im, jm); need(im, cell.j0); need(im, cell.j1); need(cell.i0, jm); need(cell.i1, jm);
+	}
+	evaluate();
+	next.clear();
+	for(auto& cell : cells) {
+	  unsigned int im = (cell.i0 + cell.i1)/2, jm = (cell.j0 + cell.j1)/2;
+	  double error = 0;
+	  for(auto ij : {std::make_pair(im, jm), std::make_pair(im, cell.j0), std::make_pair(im, cell.j1),
+		std::make_pair(cell.i0, jm), std::make_pair(cell.i1, jm)}) {
+	    double e = std::abs(z[std::size_t(ij.second)*nb_x + ij.first] - bilinear(cell, ij.first, ij.second));
+	    if(!(e <= error)) error = e; // NaN values are refined too.
+	  }
+	  bool splittable = cell.i1 - cell.i0 > 1 || cell.j1 - cell.j0 > 1;
+	  if(splittable && !(error <= tolerance)) {
+	    unsigned int is[3] = {cell.i0, im, cell.i1}, js[3] = {cell.j0, jm, cell.j1};
+	    for(unsigned int a = 0; a < 2; ++a)
+	      for(unsigned int b = 0; b < 2; ++b)
+		if(is[a] != is[a+1] && js[b] != js[b+1])
+		  next.push_back({is[a], is[a+1], js[b], js[b+1]});
+	  }
+	  else
+	    leaves.push_back(cell);
+	}
+	std::swap(cells, next);
+      }
+
+      for(auto& cell : leaves)
+	for(unsigned int j = cell.j0; j <= cell.j1; ++j)
+	  for(unsigned int i = cell.i0; i <= cell.i1; ++i) {
+	    std::size_t c = std::size_t(j)*nb_x + i;
+	    if(!known[c]) z[c] = bilinear(cell, i, j);
+	  }
+      return nb_evals;
+    }
+  }
+
+  namespace algo {
+
+    /**
+     * This fills the nb_x*nb_y grid z (row by row, y = ymin first, as for contours) with z = f(x, y), evaluating f adaptively: the grid is split into cells of coarse*coarse steps, which are refined as a quadtree where the values at their center and edge middles differ from the bilinear interpolation of their corners by more than tolerance. The nodes that are not evaluated are interpolated. At each pass, f is evaluated in parallel, it has to be thread-safe. This returns the number of evaluations.
+     */
+    template<typename F>
+    std::size_t adaptive_grid(const F& f,
+			      double xmin, double xmax, unsigned int nb_x,
+			      double ymin, double ymax, unsigned int nb_y,
+			      double tolerance, std::vector<double>& z,
+			      unsigned int coarse = 8) {
+      std::vector<char> known;
+      return internal::adaptive_grid(f, xmin, xmax, nb_x, ymin, ymax, nb_y, tolerance, coarse, z, known);
+    }
+
+    /**
+     * This is adaptive_grid, but only the evaluated nodes are returned, as values for a surface.
+     */
+    template<typename F>
+    std::size_t adaptive_values(const F& f,
+				double xmin, double xmax, unsigned int nb_x,
+				double ymin, double ymax, unsigned int nb_y,
+				double tolerance, std::vector<ValueAt>& res,
+				unsigned int coarse = 8) {
+      std::vector<double> z;
+      std::vector<char> known;
+      std::size_t nb_evals = internal::adaptive_grid(f, xmin, xmax, nb_x, ymin, ymax, nb_y, tolerance, coarse, z, known);
+      res.clear();
+      if(nb_x < 2 || nb_y < 2) return nb_evals;
+      for(std::size_t c = 0; c < z.size(); ++c)
+	if(known[c])
+	  res.push_back({xmin + (c % nb_x)*(xmax - xmin)/(nb_x - 1), ymin + (c / nb_x)*(ymax - ymin)/(nb_y - 1), z[c]});
+      return nb_evals;
+    }
+  }
+}
@@ -37,6 +37,9 @@
 #include <string>
 #include <stdexcept>
 #include <memory>
+#include <array>
+#include <algorithm>
+#include <cmath>
 
 #include <boost/asio.hpp>
 
@@ -45,6 +48,56 @@
 
 namespace ccmpl {
   namespace chart {
+
+    /**
+     * This is what the C++ side knows about the area where an element is displayed.
+     */
+    struct Viewport {
+      unsigned int width;  //!< The approximate width of the subplot, in pixels (0 if unknown).
+      unsigned int height; //!< The approximate height of the subplot, in pixels (0 if unknown).
+      bool x_fixed;        //!< Whether the x limits of the subplot are fixed (by ccmpl::view2d or by a zoom in the viewer). Levels of detail follow them.
+      bool y_fixed;        //!< Whether the y limits of the subplot are fixed (by ccmpl::view2d or by a zoom in the viewer). Levels of detail follow them.
+      bool cull;           //!< Whether elements may skip what is out of the fixed limits (see ccmpl::culling).
+      double xmin, xmax;   //!< The x limits, if fixed, enlarged by a margin of a few pixels.
+      double ymin, ymax;   //!< The y limits, if fixed, enlarged by a margin of a few pixels.
+      Viewport() : width(0), height(0), x_fixed(false), y_fixed(false), cull(false), xmin(0), xmax(0), ymin(0), ymax(0) {}
+      Viewport(unsigned int w, unsigned int h) : Viewport() {width = w; height = h;}
+      Viewport(const Viewport&) = default;
+      Viewport& operator=(const Viewport&) = default;
+
+      /**
+       * Elements can skip what is out of the view when this is true.
+       */
+      bool culls() const {return cull && (x_fixed || y_fixed);}
+      
+      /**
+       * This fixes the limits, enlarged by a margin of 10 pixels for the markers that lie across the borders.
+       */
+      void set_limits(double x1, double x2, bool fixed_x,
+		      double y1, double y2, bool fixed_y) {
+	double xmargin = std::abs(x2 - x1)*(width  == 0 ? .02 : 10./width);
+	double ymargin = std::abs(y2 - y1)*(height == 0 ? .02 : 10./height);
+	x_fixed = fixed_x;
+	y_fixed = fixed_y;
+	xmin = std::min(x1, x2) - xmargin;
+	xmax = std::max(x1, x2) + xmargin;
+	ymin = std::min(y1, y2) - ymargin;
+	ymax = std::max(y1, y2) + ymargin;
+      }
+      
+      bool visible(double x, double y) const {
+	return (!x_fixed || (x >= xmin && x <= xmax)) && (!y_fixed || (y >= ymin && y <= ymax));
+      }
+
+      /**
+       * This tells whether the box [x1,x2]x[y1,y2] (in any order) overlaps the view.
+       */
+      bool overlaps(double x1, double x2, double y1, double y2) const {
+	return (!x_fixed || (std::max(x1, x2) >= xmin && std::min(x1, x2) <= xmax))
+	  &&   (!y_fixed || (std::max(y1, y2) >= ymin && std::min(y1, y2) <= ymax));
+      }
+    };
+    
     class Element {
     public:
       
@@ -71,6 +124,9 @@ namespace ccmpl {
 
       virtual void update_activity(std::string::const_iterator& it) {
       }
+
+      virtual void setViewport(const Viewport& v) {
+      }
       
       virtual void print_data(std::ostream& os) {
       }
@@ -96,6 +152,10 @@ namespace ccmpl {
       virtual void update_activity(std::string::const_iterator& it) {
 	for(auto e : elements) e->update_activity(it);
       }
+
+      virtual void setViewport(const Viewport& v) {
+	for(auto e : elements) e->setViewport(v);
+      }
       
       void operator+=(const Element& e) {
 	elements.push_back(e.clone());
@@ -143,8 +203,9 @@ namespace ccmpl {
     public:
 
       bool active;
+      Viewport viewport;
       
-      Data(const std::string& arglist) : Element(arglist), active(true) {}
+      Data(const std::string& arglist) : Element(arglist), active(true), viewport() {}
       virtual ~Data() {}
 
       virtual void refill() = 0;
@@ -152,6 +213,10 @@ namespace ccmpl {
       virtual void update_activity(std::string::const_iterator& it) {
 	active = (*(it++) == '#');
       }
+
+      virtual void setViewport(const Viewport& v) {
+	viewport = v;
+      }
       
       void print_data(std::ostream& os) {
 	if(active) {
@@ -223,6 +288,11 @@ namespace ccmpl {
   };
 
   enum class span : char {placeholder, limits};
+
+  /**
+   * With ccmpl::culling::view (display() = ccmpl::culling::view;), the elements of a graph whose limits are fixed, by ccmpl::view2d or by a zoom in the viewer, only send what lies in the view. Nothing is culled by default. The levels of detail (decimated or pyramid lines, images in display resolution...) follow the fixed limits in both modes.
+   */
+  enum class culling : char {none, view};
   
   class view2d {
   private:
@@ -252,6 +322,9 @@ namespace ccmpl {
 	auto_y(ylim.autolim), ymin(ylim.min), ymax(ylim.max),
 	adj(s == span::placeholder ? "datalim" : "box") {}
 
+    Limit xlim() const {return auto_x ? Limit(limit::fit) : Limit(xmin, xmax);}
+    Limit ylim() const {return auto_y ? Limit(limit::fit) : Limit(ymin, ymax);}
+
     void python(std::ostream& os,
 		const std::string& line_start) {
       if(auto_aspect)
@@ -353,6 +426,7 @@ namespace ccmpl {
       Legend legend;
       std::list<chart::NbTics> nb_tics;
       std::string grid_info;
+      culling cull;
       
       Graph(const std::string& pos) 
 	: title(""), xtitle(""), ytitle(""), ztitle(""),
@@ -368,7 +442,8 @@ namespace ccmpl {
 	  is_3d(false),
 	  legend(),
 	  nb_tics(),
-	  grid_info() {}
+	  grid_info(),
+	  cull(culling::none) {}
 
 
       virtual Element* clone() const {
@@ -391,9 +466,27 @@ namespace ccmpl {
 	res->legend           = legend;
 	res-> nb_tics         = nb_tics;
 	res->grid_info        = grid_info;
+	res->cull             = cull;
 	return res;
       }
 
+      /**
+       * The view limits, when they are fixed, are added to the viewport given to the elements, so that their levels of detail follow the view. The limits reported by the viewer (after a zoom for example) are used when available, the ones of view2d otherwise. Elements only skip what is out of the view with ccmpl::culling::view.
+       */
+      virtual void setViewport(const Viewport& v) {
+	Viewport view = v;
+	view.cull = cull == culling::view;
+	if(is_3d)
+	  view.x_fixed = view.y_fixed = false;
+	else if(!view.x_fixed && !view.y_fixed) {
+	  auto xl = v2d.xlim();
+	  auto yl = v2d.ylim();
+	  view.set_limits(xl.min, xl.max, !xl.autolim,
+			  yl.min, yl.max, !yl.autolim);
+	}
+	this->Elements::setViewport(view);
+      }
+
       virtual void plot_getdata(std::ostream& os) {
 	// os << "\tax" << suffix << "_corners = None"         << std::endl;
 	// this->Elements::plot_getdata(os);
@@ -463,6 +556,10 @@ namespace ccmpl {
 	nb_tics.push_back(nbt);
       }
 
+      void operator=(culling c) {
+	cull = c;
+      }
+
       void operator=(const view2d& view_2d) {
 	is_3d = false;
 	v2d   = view_2d;
@@ -482,9 +579,67 @@ namespace ccmpl {
       ccmpl::RGB facecolor;
       std::vector<Graph*> graphs;
       std::vector<Graph*>::iterator current;
+      std::vector<std::array<unsigned int, 4>> cells; // line_begin, line_end, column_begin, column_end for each graph.
       std::string pdf_name, png_name;
       int png_dpi;
+      int screen_dpi;
+      std::vector<Viewport> feedback; // The views reported by the viewer at last frame, for each graph.
       std::list<double> wratios, hratios;
+
+      // This is the fraction of the total size spanned by [begin, end[ in a gridspec.
+      static double span_ratio(const std::list<double>& ratios, unsigned int nb, unsigned int begin, unsigned int end) {
+	if(ratios.size() != nb)
+	  return (end - begin)/(double)nb;
+	double total = 0, span = 0;
+	unsigned int i = 0;
+	for(auto r : ratios) {
+	  total += r;
+	  if(i >= begin && i < end) span += r;
+	  ++i;
+	}
+	return span/total;
+      }
+
+      // This computes the approximate pixel size of each graph and
+      // notifies its elements. The views reported by the viewer are
+      // used instead when they are available.
+      void update_viewports() {
+	auto cell = cells.begin();
+	unsigned int g = 0;
+	for(auto g_ptr : graphs) {
+	  auto& c = *(cell++);
+	  if(g < feedback.size())
+	    g_ptr->setViewport(feedback[g]);
+	  else
+	    g_ptr->setViewport(Viewport((unsigned int)(xsize*screen_dpi*span_ratio(wratios, width,  c[2], c[3])),
+					(unsigned int)(ysize*screen_dpi*span_ratio(hratios, height, c[0], c[1]))));
+	  ++g;
+	}
+      }
+
+      // The viewer acknowledges each frame with a line starting with
+      // '!', followed, for each graph, by its xmin xmax ymin ymax, its
+      // size in pixels, and whether x and y are free. Limits that are
+      // not free (fixed by ccmpl::view2d, or by a zoom in the GUI) are
+      // given to the elements. Limits that the viewer sets by itself,
+      // to fit an image or contours, are reported as free.
+      void read_feedback(const std::string& ack) {
+	std::istringstream is(ack);
+	std::string bang;
+	is >> bang;
+	std::vector<Viewport> views;
+	for(unsigned int g = 0; g < graphs.size(); ++g) {
+	  double x1, x2, y1, y2;
+	  unsigned int w, h;
+	  int auto_x, auto_y;
+	  if(!(is >> x1 >> x2 >> y1 >> y2 >> w >> h >> auto_x >> auto_y))
+	    return; // Malformed, the estimated viewports are kept.
+	  Viewport v(w, h);
+	  v.set_limits(x1, x2, !auto_x, y1, y2, !auto_y);
+	  views.push_back(v);
+	}
+	feedback = views;
+      }
       
     public:
       
@@ -516,7 +671,7 @@ namespace ccmpl {
        */
       Layout(std::string hostname, std::string port, double sx, double sy, const std::initializer_list<const char*>& placeholders, ccmpl::RGB fc=ccmpl::RGB(.75, .75, .75))
 	: tcp_stream_ptr(std::make_shared<boost::asio::ip::tcp::iostream>(hostname, port)),
-	  xsize(sx), ysize(sy), facecolor(fc) {
+	  xsize(sx), ysize(sy), facecolor(fc), screen_dpi(100), feedback() {
 	
 	height = placeholders.size();
 	unsigned int lineid = 0;
@@ -533,24 +688,28 @@ namespace ccmpl {
 	      g = new Graph(grid_pos.str());
 	      *this += g;
 	      graphs.push_back(g);
+	      cells.push_back({lineid, lineid+1, columnid, columnid+1});
 	      break;
 	    case '>':
 	      grid_pos << lineid << ',' << columnid << ':' << columnid+2;
 	      g = new Graph(grid_pos.str());
 	      *this += g;
 	      graphs.push_back(g);
+	      cells.push_back({lineid, lineid+1, columnid, columnid+2});
 	      break;
 	    case 'V':
 	      grid_pos << lineid << ':' << lineid+2 << ',' << columnid;
 	      g = new Graph(grid_pos.str());
 	      *this += g;
 	      graphs.push_back(g);
+	      cells.push_back({lineid, lineid+2, columnid, columnid+1});
 	      break;
 	    case 'X':
 	      grid_pos << lineid << ':' << lineid+2 << ',' << columnid << ':' << columnid+2;
 	      g = new Graph(grid_pos.str());
 	      *this += g;
 	      graphs.push_back(g);
+	      cells.push_back({lineid, lineid+2, columnid, columnid+2});
 	      break;
 	    default:
 	      *this += new Element(""); // empty slot
@@ -600,15 +759,17 @@ namespace ccmpl {
       void operator()(const std::string& s,
 		      const std::string& pdf,
 		      const std::pair<std::string, int>& png_data) {
-	char c;
+	std::string ack;
 	auto it = s.begin();
 	update_activity(it);
 	pdf_name = pdf;
 	png_name = png_data.first;
 	png_dpi = png_data.second;
+	update_viewports();
 	if(*tcp_stream_ptr) {
 	  print_data(*tcp_stream_ptr);
-	  tcp_stream_ptr->get(c); // Acknowledgement from server.
+	  std::getline(*tcp_stream_ptr, ack); // Acknowledgement from server.
+	  read_feedback(ack);
 	}
 	else
 	  throw std::runtime_error("Not connected to display server");
@@ -625,6 +786,13 @@ namespace ccmpl {
       
 
 
+      /**
+       * This sets the resolution of the screen (100 by default, as matplotlib). It is used for estimating the pixel size of the graphs, so that elements can reduce the data they send to what can actually be displayed.
+       */
+      void set_dpi(int dpi) {
+	screen_dpi = dpi;
+      }
+
       void set_ratios(const std::initializer_list<double>& width_ratios, 
 		      const std::initializer_list<double>& height_ratios) {
 	wratios.clear();
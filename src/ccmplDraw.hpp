@@ -32,9 +32,16 @@
 #include <array>
 #include <iostream>
 #include <memory>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <cctype>
 
 #include <ccmplTypes.hpp>
 #include <ccmplChart.hpp>
+#include <ccmplUtility.hpp>
+#include <ccmplAlgo.hpp>
+#include <ccmplStats.hpp>
 
 namespace ccmpl {
 
@@ -178,6 +185,88 @@ namespace ccmpl {
     return Hbar(arglist,f);
   }
 
+  /**
+   * ccmpl::rendering::viewer sends the points to matplotlib, ccmpl::rendering::raster aggregates them in C++ on a pixel grid sized to the subplot, and sends it as an image. The cost then depends on the size of the subplot rather than on the number of points. Points are counted by ccmpl::dots, their colors are blended by ccmpl::confetti, and their values are averaged (and interpolated where there are no points) by ccmpl::surface.
+   */
+  enum class rendering : char {viewer, raster};
+
+  namespace internal {
+
+    // This is the frame, sized to the subplot, on which the items are
+    // aggregated for ccmpl::rendering::raster. It spans the view limits
+    // when they are fixed, and the items otherwise.
+    template<typename IT>
+    algo::Frame raster_frame(IT begin, IT end, const chart::Viewport& viewport) {
+      auto frame = algo::bounding_frame(begin, end,
+					viewport.width  == 0 ? 256 : viewport.width,
+					viewport.height == 0 ? 256 : viewport.height);
+      if(viewport.x_fixed) {frame.xmin = viewport.xmin; frame.xmax = viewport.xmax;}
+      if(viewport.y_fixed) {frame.ymin = viewport.ymin; frame.ymax = viewport.ymax;}
+      return frame;
+    }
+
+    /**
+     * This sends exactly the counts, as a line starting with "dense". If less than sparse_ratio of the counts are not null, the line starts with "sparse" and only contains (index, count) pairs for the non-null counts.
+     */
+    template<typename COUNTS>
+    void print_counts(std::ostream& os, const COUNTS& hits, double sparse_ratio = .25) {
+      std::size_t nb_nonzero = std::count_if(hits.begin(), hits.end(), [](auto hit) {return hit != 0;});
+      if(nb_nonzero < sparse_ratio*hits.size()) {
+	os << "sparse";
+	std::size_t idx = 0;
+	for(auto hit : hits) {
+	  if(hit != 0)
+	    os << ' ' << idx << ' ' << hit;
+	  ++idx;
+	}
+      }
+      else {
+	os << "dense";
+	for(auto hit : hits) 
+	  os << ' ' << hit;
+      }
+      os << std::endl;
+    }
+
+    inline void print_line(std::ostream& os, const std::vector<Point>& points) {
+      for(auto& pt : points) 
+	os << ' ' << pt.x;
+      os << std::endl;
+      for(auto& pt : points) 
+	os << ' ' << pt.y;
+      os << std::endl;	
+    }
+
+    inline void print_frame(std::ostream& os, const algo::Frame& frame) {
+      os << frame.xmin << ' ' << frame.xmax << ' ' << frame.ymin << ' ' << frame.ymax << ' '
+	 << frame.width << ' ' << frame.height << std::endl;
+    }
+
+    /**
+     * This sends the average colors of cells accumulated by algo::splat<3> as a single line of hexadecimal RGBA bytes, 8 characters per cell. Empty cells are fully transparent.
+     */
+    inline void print_blend(std::ostream& os, const std::vector<double>& acc) {
+      static const char digits[] = "0123456789abcdef";
+      std::size_t nb_cells = acc.size()/4;
+      std::string line(8*nb_cells, '0');
+      internal::parallel_for(nb_cells, 4096,
+			     [&line, &acc](unsigned int, std::size_t first, std::size_t last) {
+			       for(std::size_t c = first; c < last; ++c) {
+				 const double* cell = acc.data() + 4*c;
+				 if(cell[0] == 0) continue;
+				 char* out = &line[8*c];
+				 for(unsigned int k = 0; k < 4; ++k) {
+				   double v = k < 3 ? cell[k+1]/cell[0] : 1;
+				   unsigned int byte = (unsigned int)(std::min(std::max(v, 0.), 1.)*255 + .5);
+				   out[2*k]   = digits[byte >> 4];
+				   out[2*k+1] = digits[byte & 15];
+				 }
+			       }
+			     });
+      os << line << std::endl;
+    }
+  }
+
   //////////
   //      //
   // Dots //
@@ -188,24 +277,55 @@ namespace ccmpl {
   public:
     std::vector<Point> points;
     std::function<void (std::vector<Point>&)> fill;
+    rendering mode;
+    const algo::PointIndex* index; //!< If not null, the points are queried from this index rather than filled.
+    std::vector<double> acc;
+    std::vector<unsigned long> counts;
+    std::vector<Point> visible;
       
     template<typename FILL>
     Dots(const std::string& arglist,
-	 const FILL& f) : chart::Data(arglist), fill(f) {}
+	 const FILL& f,
+	 rendering mode = rendering::viewer) : chart::Data(arglist), fill(f), mode(mode), index(nullptr), acc(), counts(), visible() {}
+    Dots(const std::string& arglist,
+	 const algo::PointIndex& index,
+	 rendering mode = rendering::viewer) : chart::Data(arglist), fill(), mode(mode), index(&index), acc(), counts(), visible() {}
     virtual ~Dots() {}
       
     virtual chart::Element* clone() const {
-      Dots* res = new Dots(args,fill);
+      Dots* res = index ? new Dots(args,*index,mode) : new Dots(args,fill,mode);
       res->points = points;
       return res;
     }
 
     virtual void refill() {
-      fill(points);
+      if(index) {
+	if(viewport.culls())
+	  index->query(viewport.x_fixed ? viewport.xmin : -HUGE_VAL, viewport.x_fixed ? viewport.xmax : HUGE_VAL,
+		       viewport.y_fixed ? viewport.ymin : -HUGE_VAL, viewport.y_fixed ? viewport.ymax : HUGE_VAL,
+		       points);
+	else
+	  points = index->points();
+      }
+      else
+	fill(points);
     }
 			    
 
     virtual void _print_data(std::ostream& os) {
+      if(mode == rendering::viewer && viewport.culls() && !index) {
+	algo::select(points.begin(), points.end(), [this](const Point& pt) {return viewport.visible(pt.x, pt.y);}, visible);
+	internal::print_line(os, visible);
+	return;
+      }
+      if(mode == rendering::raster) {
+	auto frame = internal::raster_frame(points.begin(), points.end(), viewport);
+	algo::splat<0>(points.begin(), points.end(), frame, [](const Point&, double*) {}, acc);
+	counts.assign(acc.begin(), acc.end());
+	internal::print_frame(os, frame);
+	internal::print_counts(os, counts);
+	return;
+      }
       for(auto& pt : points) 
 	os << ' ' << pt.x;
       os << std::endl;
@@ -215,7 +335,10 @@ namespace ccmpl {
     }
 
     virtual void plot_getdata(std::ostream& os) {
-      python::get_dots(os,suffix,args);
+      if(mode == rendering::raster)
+	python::get_density(os,suffix,"dots",args);
+      else
+	python::get_dots(os,suffix,args);
     }
 
     virtual void plot(std::ostream& os) {
@@ -229,7 +352,58 @@ namespace ccmpl {
     return Dots(arglist,f);
   }
 
+  /**
+   * With ccmpl::rendering::raster, the number of points in each pixel is displayed, and the args are the ones of matplotlib imshow (cmap, norm...). Empty pixels are transparent.
+   */
+  template<typename FILL>
+  Dots dots(const std::string& arglist, const FILL& f, rendering mode) {
+    return Dots(arglist,f,mode);
+  }
+
+  /**
+   * This displays a large static set of points, indexed once. When the view limits are fixed and culling is enabled (see ccmpl::culling), only the points in the view are retrieved from the index at each frame, without scanning all of them. The index has to live as long as the display.
+   */
+  inline Dots dots(const std::string& arglist, const algo::PointIndex& index, rendering mode = rendering::viewer) {
+    return Dots(arglist,index,mode);
+  }
 
+
+  /**
+   * ccmpl::simplification::none sends all the vertices of polylines. Otherwise, the vertices that make no visible difference are removed before sending, with a tolerance given in pixels: ccmpl::simplification::douglas_peucker removes the vertices closer than the tolerance to the simplified line, ccmpl::simplification::visvalingam removes the vertices forming triangles smaller than tolerance² square pixels with their neighbours. Unlike decimation, this suits polylines that are not sorted by x (trajectories, boundaries...).
+   */
+  enum class simplification : char {none, douglas_peucker, visvalingam};
+
+  namespace internal {
+
+    /**
+     * This computes the data units per pixel, from the fixed limits of the view, or from the range of the data otherwise.
+     */
+    inline void pixel_scales(const chart::Viewport& viewport,
+			     std::pair<double, double> xrange, std::pair<double, double> yrange,
+			     double& xscale, double& yscale) {
+      if(viewport.x_fixed) xrange = {viewport.xmin, viewport.xmax};
+      if(viewport.y_fixed) yrange = {viewport.ymin, viewport.ymax};
+      xscale = (xrange.second - xrange.first)/(viewport.width  == 0 ? 1024 : viewport.width);
+      yscale = (yrange.second - yrange.first)/(viewport.height == 0 ? 1024 : viewport.height);
+      // Degenerated ranges do not prevent the other direction from being simplified.
+      if(!(xscale > 0) || std::isinf(xscale)) xscale = 1;
+      if(!(yscale > 0) || std::isinf(yscale)) yscale = 1;
+    }
+
+    inline void simplify(const std::vector<Point>& points, simplification method,
+			 double xscale, double yscale, double tolerance,
+			 std::vector<std::size_t>& kept) {
+      switch(method) {
+      case simplification::douglas_peucker: algo::douglas_peucker(points, xscale, yscale, tolerance, kept); break;
+      case simplification::visvalingam:     algo::visvalingam(points, xscale, yscale, tolerance, kept);     break;
+      default:
+	kept.resize(points.size());
+	for(std::size_t i = 0; i < kept.size(); ++i) kept[i] = i;
+	break;
+      }
+    }
+  }
+  
   /////////////
   //         //
   // Between //
@@ -241,14 +415,20 @@ namespace ccmpl {
   public:
     std::vector<YRange> points;
     std::function<void (std::vector<YRange>&)> fill;
+    simplification method;
+    double tolerance; //!< In pixels.
+    std::vector<Point> outlines[2];
+    std::vector<std::size_t> kept[2], merged;
       
     template<typename FILL>
     Between(const std::string& arglist,
-	    const FILL& f) : chart::Data(arglist), fill(f) {}
+	    const FILL& f,
+	    simplification method = simplification::none,
+	    double tolerance = .5) : chart::Data(arglist), fill(f), method(method), tolerance(tolerance) {}
     virtual ~Between() {}
       
     virtual chart::Element* clone() const {
-      Between* res = new Between(args,fill);
+      Between* res = new Between(args,fill,method,tolerance);
       res->points = points;
       return res;
     }
@@ -256,18 +436,46 @@ namespace ccmpl {
     virtual void refill() {
       fill(points);
     }
-			    
 
-    virtual void _print_data(std::ostream& os) {
-      for(auto& pt : points) 
-	os << ' ' << pt.x;
+    template<typename VALUE>
+    void print_values(std::ostream& os, const VALUE& value) {
+      if(method == simplification::none)
+	for(auto& pt : points) 
+	  os << ' ' << value(pt);
+      else
+	for(auto i : merged)
+	  os << ' ' << value(points[i]);
       os << std::endl;
-      for(auto& pt : points) 
-	os << ' ' << pt.y1;
-      os << std::endl;	
-      for(auto& pt : points) 
-	os << ' ' << pt.y2;
-      os << std::endl;	
+    }
+
+    // Both outlines are simplified, and the abscissas kept by any of
+    // them are sent, since fill_between needs the same x for y1 and y2.
+    void simplify() {
+      auto xrange = algo::bounds(points.begin(), points.end(), [](const YRange& r) {return r.x;});
+      auto yrange = algo::bounds(points.begin(), points.end(), [](const YRange& r) {return std::min(r.y1, r.y2);});
+      yrange.second = algo::bounds(points.begin(), points.end(), [](const YRange& r) {return std::max(r.y1, r.y2);}).second;
+      double xscale, yscale;
+      internal::pixel_scales(viewport, xrange, yrange, xscale, yscale);
+      internal::parallel_for(2, internal::grain_for(points.size()),
+			     [this, xscale, yscale](unsigned int, std::size_t first, std::size_t last) {
+			       for(std::size_t o = first; o < last; ++o) {
+				 auto& outline = outlines[o];
+				 outline.clear();
+				 for(auto& pt : points)
+				   outline.push_back({pt.x, o == 0 ? pt.y1 : pt.y2});
+				 internal::simplify(outline, method, xscale, yscale, tolerance, kept[o]);
+			       }
+			     });
+      merged.clear();
+      std::set_union(kept[0].begin(), kept[0].end(), kept[1].begin(), kept[1].end(), std::back_inserter(merged));
+    }
+
+    virtual void _print_data(std::ostream& os) {
+      if(method != simplification::none)
+	simplify();
+      print_values(os, [](const YRange& pt) {return pt.x;});
+      print_values(os, [](const YRange& pt) {return pt.y1;});
+      print_values(os, [](const YRange& pt) {return pt.y2;});
     }
 
     virtual void plot_getdata(std::ostream& os) {
@@ -285,6 +493,98 @@ namespace ccmpl {
     return Between(arglist,f);
   }
 
+  /**
+   * The outlines are simplified with a tolerance given in pixels (see ccmpl::simplification).
+   */
+  template<typename FILL>
+  Between between(const std::string& arglist,const FILL& f, simplification method, double tolerance = .5) {
+    return Between(arglist,f,method,tolerance);
+  }
+
+  //////////
+  //      //
+  // Band //
+  //      //
+  //////////
+
+  // This displays the spread of a stats::Ensemble that you feed with
+  // runs in your own code, as a between area, with an optional mean
+  // line. The area is delimited by the low and high quantiles if the
+  // ensemble estimates them, by the mean +/- nb_std standard deviations
+  // otherwise. Only the band is sent. The ensemble has to live as long
+  // as the display.
+
+  class Band : public chart::Data {
+  public:
+
+    stats::Ensemble& ensemble;
+    double nb_std;
+    bool with_mean;
+    std::string mean_args;
+    std::vector<double> y1, y2;
+      
+    Band(const std::string& arglist, stats::Ensemble& ensemble, double nb_std, bool with_mean, const std::string& mean_arglist) 
+      : chart::Data(arglist), ensemble(ensemble), nb_std(nb_std), with_mean(with_mean), mean_args(mean_arglist), y1(), y2() {}
+    virtual ~Band() {}
+      
+    virtual void _print_data(std::ostream& os) {
+      std::size_t size = ensemble.x.size();
+      y1.resize(size);
+      y2.resize(size);
+      internal::parallel_for(size, 1024,
+			     [this](unsigned int, std::size_t first, std::size_t last) {
+			       for(std::size_t i = first; i < last; ++i)
+				 if(ensemble.percentiles) {
+				   y1[i] = ensemble.low[i].value();
+				   y2[i] = ensemble.high[i].value();
+				 }
+				 else {
+				   double d = nb_std*ensemble.deviation(i);
+				   y1[i] = ensemble.mean[i] - d;
+				   y2[i] = ensemble.mean[i] + d;
+				 }
+			     });
+      for(auto v : ensemble.x) os << ' ' << v;
+      os << std::endl;
+      for(auto v : y1) os << ' ' << v;
+      os << std::endl;
+      for(auto v : y2) os << ' ' << v;
+      os << std::endl;
+      if(with_mean) {
+	for(auto v : ensemble.mean) os << ' ' << v;
+	os << std::endl;
+      }
+    }
+
+    virtual chart::Element* clone() const {
+      return new Band(args, ensemble, nb_std, with_mean, mean_args);
+    }
+
+    virtual void refill() {}
+
+    virtual void plot_getdata(std::ostream& os) {
+      python::get_band(os,suffix,args,with_mean);
+    }
+
+    virtual void plot(std::ostream& os) {
+      python::plot_band(os,suffix,with_mean,mean_args);
+    }
+  };
+
+  /**
+   * The args are the ones of matplotlib fill_between.
+   */
+  inline Band band(const std::string& arglist, stats::Ensemble& ensemble, double nb_std = 1) {
+    return Band(arglist, ensemble, nb_std, false, "");
+  }
+
+  /**
+   * The mean is drawn as well, mean_arglist being the args of matplotlib plot.
+   */
+  inline Band band(const std::string& arglist, const std::string& mean_arglist, stats::Ensemble& ensemble, double nb_std = 1) {
+    return Band(arglist, ensemble, nb_std, true, mean_arglist);
+  }
+
   /////////
   //     //
   // Pie //
@@ -357,6 +657,68 @@ namespace ccmpl {
 
 
   
+  /**
+   * ccmpl::decimation::none sends all the points of a line. Otherwise, lines with more points than the subplot has pixel columns are reduced before being sent: ccmpl::decimation::minmax keeps the first, last, lowest and highest points of each pixel column, which draws exactly as the whole line does, spikes included, while ccmpl::decimation::lttb keeps one point per column with the Largest-Triangle-Three-Buckets algorithm, which preserves the visual shape. In both cases, the points have to be sorted by increasing x, and when the x limits are fixed (by ccmpl::view2d or by a zoom in the viewer), only the points within them (and their neighbours) are reduced, whatever the ccmpl::culling mode.
+   */
+  enum class decimation : char {none, minmax, lttb};
+
+  namespace internal {
+
+    inline void decimate(const std::vector<Point>& points, decimation reduction,
+			 const chart::Viewport& viewport, std::vector<Point>& res) {
+      unsigned int nb_columns = viewport.width == 0 ? 1024 : viewport.width;
+      switch(reduction) {
+      case decimation::minmax: algo::minmax_decimation(points, nb_columns, res); break;
+      case decimation::lttb:   algo::lttb_decimation(points, nb_columns, res);   break;
+      default:                 res = points;                                     break;
+      }
+    }
+
+    /**
+     * This keeps the points of a polyline that belong to a segment overlapping the view. A NaN point is inserted where out of view parts are removed, so that matplotlib breaks the line there.
+     */
+    inline void cull_polyline(const std::vector<Point>& points, const chart::Viewport& viewport, std::vector<Point>& res) {
+      res.clear();
+      std::size_t size = points.size();
+      bool gap = false;
+      for(std::size_t i = 0; i < size; ++i) {
+	const Point& pt = points[i];
+	bool keep = (size == 1 && viewport.visible(pt.x, pt.y))
+	  || (i > 0        && viewport.overlaps(points[i-1].x, pt.x, points[i-1].y, pt.y))
+	  || (i + 1 < size && viewport.overlaps(pt.x, points[i+1].x, pt.y, points[i+1].y));
+	if(keep) {
+	  if(gap && res.size() != 0) res.push_back({std::nan(""), std::nan("")});
+	  res.push_back(pt);
+	  gap = false;
+	}
+	else
+	  gap = true;
+      }
+    }
+
+    /**
+     * This computes the points of a polyline that are actually sent. When the view has fixed limits and culling is enabled, the polyline is culled. Otherwise, or if a decimation is required, the points are supposed to be sorted by x, so only the ones within the x limits (and their neighbours) are kept before decimating.
+     */
+    inline void visible_polyline(const std::vector<Point>& points, decimation reduction,
+				 const chart::Viewport& viewport,
+				 std::vector<Point>& buffer, std::vector<Point>& res) {
+      if(reduction == decimation::none) {
+	cull_polyline(points, viewport, res);
+	return;
+      }
+      if(!viewport.x_fixed) {
+	decimate(points, reduction, viewport, res);
+	return;
+      }
+      auto first = std::lower_bound(points.begin(), points.end(), viewport.xmin, [](const Point& pt, double x) {return pt.x < x;});
+      auto last  = std::upper_bound(points.begin(), points.end(), viewport.xmax, [](double x, const Point& pt) {return x < pt.x;});
+      if(first != points.begin()) --first;
+      if(last  != points.end())   ++last;
+      buffer.assign(first, last);
+      decimate(buffer, reduction, viewport, res);
+    }
+  }
+
   //////////
   //      //
   // Line //
@@ -368,30 +730,43 @@ namespace ccmpl {
   public:
     std::vector<Point> points;
     std::function<void (std::vector<Point>&)> fill;
+    decimation reduction;
+    const algo::MinMaxPyramid* pyramid; //!< If not null, the points are reduced from this pyramid rather than filled.
+    std::vector<Point> buffer, decimated;
       
     template<typename FILL>
     Line(const std::string& arglist,
-	 const FILL& f) : chart::Data(arglist), fill(f) {}
+	 const FILL& f,
+	 decimation reduction = decimation::none) : chart::Data(arglist), fill(f), reduction(reduction), pyramid(nullptr), buffer(), decimated() {}
+    Line(const std::string& arglist,
+	 const algo::MinMaxPyramid& pyramid) : chart::Data(arglist), fill(), reduction(decimation::minmax), pyramid(&pyramid), buffer(), decimated() {}
     virtual ~Line() {}
       
     virtual chart::Element* clone() const {
-      Line* res = new Line(args,fill);
+      Line* res = pyramid ? new Line(args,*pyramid) : new Line(args,fill,reduction);
       res->points = points;
       return res;
     }
 
     virtual void refill() {
-      fill(points);
+      if(!pyramid) fill(points);
     }
 			    
 
     virtual void _print_data(std::ostream& os) {
-      for(auto& pt : points) 
-	os << ' ' << pt.x;
-      os << std::endl;
-      for(auto& pt : points) 
-	os << ' ' << pt.y;
-      os << std::endl;	
+      if(pyramid) {
+	pyramid->query(viewport.x_fixed ? viewport.xmin : -HUGE_VAL, viewport.x_fixed ? viewport.xmax : HUGE_VAL,
+		       viewport.width == 0 ? 1024 : viewport.width,
+		       decimated);
+	internal::print_line(os, decimated);
+	return;
+      }
+      if(reduction == decimation::none && !viewport.culls()) {
+	internal::print_line(os, points);
+	return;
+      }
+      internal::visible_polyline(points, reduction, viewport, buffer, decimated);
+      internal::print_line(os, decimated);
     }
 
     virtual void plot_getdata(std::ostream& os) {
@@ -409,6 +784,18 @@ namespace ccmpl {
     return Line(arglist,f);
   }
 
+  template<typename FILL>
+  Line line(const std::string& arglist,const FILL& f, decimation reduction) {
+    return Line(arglist,f,reduction);
+  }
+
+  /**
+   * This displays a large static series, reduced at each frame for the x window currently displayed (which follows the zooms in the viewer, whatever the ccmpl::culling mode) from a min/max pyramid built once. The pyramid has to live as long as the display.
+   */
+  inline Line line(const std::string& arglist, const algo::MinMaxPyramid& pyramid) {
+    return Line(arglist,pyramid);
+  }
+
   
   ///////////
   //       //
@@ -420,14 +807,24 @@ namespace ccmpl {
   public:
     std::vector<std::vector<Point> > lines;
     std::function<void (std::vector<std::vector<Point>>&)> fill;
+    decimation reduction;
+    simplification method;
+    double tolerance; //!< In pixels.
+    std::vector<std::vector<Point> > decimated;
       
     template<typename FILL>
     Lines(const std::string& arglist,
-	  const FILL& f) : chart::Data(arglist), fill(f) {}
+	  const FILL& f,
+	  decimation reduction = decimation::none) : chart::Data(arglist), fill(f), reduction(reduction), method(simplification::none), tolerance(0), decimated() {}
+    template<typename FILL>
+    Lines(const std::string& arglist,
+	  const FILL& f,
+	  simplification method,
+	  double tolerance) : chart::Data(arglist), fill(f), reduction(decimation::none), method(method), tolerance(tolerance), decimated() {}
     virtual ~Lines() {}
       
     virtual chart::Element* clone() const {
-      Lines* res = new Lines(args,fill);
+      Lines* res = method == simplification::none ? new Lines(args,fill,reduction) : new Lines(args,fill,method,tolerance);
       res->lines = lines;
       return res;
     }
@@ -439,14 +836,50 @@ namespace ccmpl {
 
     virtual void _print_data(std::ostream& os) {
       os << lines.size() << std::endl;
-      for(auto& points : lines) {
-	for(auto& pt : points) 
-	  os << ' ' << pt.x;
-	os << std::endl;
-	for(auto& pt : points) 
-	  os << ' ' << pt.y;
-	os << std::endl;
+      if(reduction == decimation::none && method == simplification::none && !viewport.culls()) {
+	for(auto& points : lines)
+	  internal::print_line(os, points);
+	return;
+      }
+
+      double xscale = 1, yscale = 1;
+      if(method != simplification::none) {
+	std::pair<double, double> xrange = {HUGE_VAL, -HUGE_VAL}, yrange = {HUGE_VAL, -HUGE_VAL};
+	for(auto& points : lines) {
+	  auto xr = algo::bounds(points.begin(), points.end(), [](const Point& pt) {return pt.x;});
+	  auto yr = algo::bounds(points.begin(), points.end(), [](const Point& pt) {return pt.y;});
+	  xrange = {std::min(xrange.first, xr.first), std::max(xrange.second, xr.second)};
+	  yrange = {std::min(yrange.first, yr.first), std::max(yrange.second, yr.second)};
+	}
+	internal::pixel_scales(viewport, xrange, yrange, xscale, yscale);
       }
+      
+      // Lines are culled, decimated and simplified in parallel.
+      decimated.resize(lines.size());
+      std::size_t nb_points = 0;
+      for(auto& line : lines) nb_points += line.size();
+      internal::parallel_for(lines.size(), internal::grain_for(nb_points/std::max<std::size_t>(lines.size(), 1)),
+			     [this, xscale, yscale](unsigned int, std::size_t first, std::size_t last) {
+			       std::vector<Point> buffer, visible;
+			       std::vector<std::size_t> kept;
+			       for(std::size_t l = first; l < last; ++l) {
+				 if(method == simplification::none) {
+				   internal::visible_polyline(lines[l], reduction, viewport, buffer, decimated[l]);
+				   continue;
+				 }
+				 const std::vector<Point>* points = &lines[l];
+				 if(viewport.culls()) {
+				   internal::cull_polyline(lines[l], viewport, visible);
+				   points = &visible;
+				 }
+				 internal::simplify(*points, method, xscale, yscale, tolerance, kept);
+				 auto& res = decimated[l];
+				 res.clear();
+				 for(auto i : kept) res.push_back((*points)[i]);
+			       }
+			     });
+      for(auto& points : decimated)
+	internal::print_line(os, points);
     }
 
     virtual void plot_getdata(std::ostream& os) {
@@ -464,6 +897,482 @@ namespace ccmpl {
     return Lines(arglist,f);
   }
 
+  template<typename FILL>
+  Lines lines(const std::string& arglist,const FILL& f, decimation reduction) {
+    return Lines(arglist,f,reduction);
+  }
+
+  /**
+   * The lines are simplified with a tolerance given in pixels (see ccmpl::simplification), which suits trajectories or boundaries rather than time series.
+   */
+  template<typename FILL>
+  Lines lines(const std::string& arglist,const FILL& f, simplification method, double tolerance = .5) {
+    return Lines(arglist,f,method,tolerance);
+  }
+
+
+  /////////////
+  //         //
+  // Signals //
+  //         //
+  /////////////
+
+  namespace internal {
+
+    /**
+     * This computes the range [first,last[ of the samples x0 + i*dx, i < n, that are within the x limits of the view (and their neighbours).
+     */
+    inline void visible_samples(double x0, double dx, std::size_t n, const chart::Viewport& viewport,
+				std::size_t& first, std::size_t& last) {
+      first = 0;
+      last  = n;
+      if(!viewport.x_fixed || !(dx > 0) || n == 0) return;
+      double lo = std::floor((viewport.xmin - x0)/dx);
+      double hi = std::ceil((viewport.xmax - x0)/dx) + 1;
+      first = lo <= 0 ? 0 : (lo >= n ? n : std::size_t(lo));
+      last  = hi <= 0 ? 0 : (hi >= n ? n : std::size_t(hi));
+      if(last < first) last = first;
+    }
+
+    // x0 and dx are sent with full precision, since the error on dx
+    // is multiplied by the number of samples.
+    inline void print_sampling(std::ostream& os, double x0, double dx, std::size_t first, std::size_t last) {
+      auto precision = os.precision(std::numeric_limits<double>::max_digits10);
+      os << x0 + first*dx << ' ' << dx << ' ' << last - first << std::endl;
+      os.precision(precision);
+    }
+
+    inline void print_samples(std::ostream& os, const std::vector<double>& y, std::size_t first, std::size_t last) {
+      for(std::size_t i = first; i < last; ++i)
+	os << ' ' << y[i];
+      os << std::endl;
+    }
+  }
+
+  /**
+   * This is a line whose points are x0 + i*dx, y[i]. Only x0, dx and the y values are sent, the viewer rebuilds the abscissas when they change. When the x limits of the view are fixed, only the visible samples are sent.
+   */
+  class Signal : public chart::Data {
+  public:
+    double x0, dx;
+    std::vector<double> y;
+    std::function<void (double&, double&, std::vector<double>&)> fill;
+      
+    template<typename FILL>
+    Signal(const std::string& arglist,
+	   const FILL& f) : chart::Data(arglist), x0(0), dx(1), y(), fill(f) {}
+    virtual ~Signal() {}
+      
+    virtual chart::Element* clone() const {
+      Signal* res = new Signal(args,fill);
+      res->x0 = x0;
+      res->dx = dx;
+      res->y  = y;
+      return res;
+    }
+
+    virtual void refill() {
+      fill(x0, dx, y);
+    }
+			    
+    virtual void _print_data(std::ostream& os) {
+      std::size_t first, last;
+      internal::visible_samples(x0, dx, y.size(), viewport, first, last);
+      internal::print_sampling(os, x0, dx, first, last);
+      internal::print_samples(os, y, first, last);
+    }
+
+    virtual void plot_getdata(std::ostream& os) {
+      python::get_signal(os,suffix);
+    }
+
+    virtual void plot(std::ostream& os) {
+      python::plot_signal(os,suffix,args);
+    }
+      
+  };
+
+  /**
+   * f(x0, dx, y) sets the samples y[i], located at x0 + i*dx.
+   */
+  template<typename FILL>
+  Signal signal(const std::string& arglist,const FILL& f) {
+    return Signal(arglist,f);
+  }
+
+  /**
+   * These are curves sharing the same uniform sampling x0 + i*dx, which is sent once for all the curves.
+   */
+  class Signals : public chart::Data {
+  public:
+    double x0, dx;
+    std::vector<std::vector<double>> ys;
+    std::function<void (double&, double&, std::vector<std::vector<double>>&)> fill;
+      
+    template<typename FILL>
+    Signals(const std::string& arglist,
+	    const FILL& f) : chart::Data(arglist), x0(0), dx(1), ys(), fill(f) {}
+    virtual ~Signals() {}
+      
+    virtual chart::Element* clone() const {
+      Signals* res = new Signals(args,fill);
+      res->x0 = x0;
+      res->dx = dx;
+      res->ys = ys;
+      return res;
+    }
+
+    virtual void refill() {
+      fill(x0, dx, ys);
+    }
+			    
+    virtual void _print_data(std::ostream& os) {
+      std::size_t n = ys.size() == 0 ? 0 : ys.front().size();
+      for(auto& y : ys) n = std::min(n, y.size());
+      std::size_t first, last;
+      internal::visible_samples(x0, dx, n, viewport, first, last);
+      os << ys.size() << std::endl;
+      internal::print_sampling(os, x0, dx, first, last);
+      for(auto& y : ys)
+	internal::print_samples(os, y, first, last);
+    }
+
+    virtual void plot_getdata(std::ostream& os) {
+      python::get_signals(os,suffix,args);
+    }
+
+    virtual void plot(std::ostream& os) {
+      python::plot_signals(os,suffix);
+    }
+      
+  };
+
+  /**
+   * f(x0, dx, ys) sets the curves ys[l], whose samples ys[l][i] are located at x0 + i*dx. The curves are truncated to the shortest one.
+   */
+  template<typename FILL>
+  Signals signals(const std::string& arglist,const FILL& f) {
+    return Signals(arglist,f);
+  }
+
+  /**
+   * This fills the area between two uniformly sampled curves, as ccmpl::between does.
+   */
+  class SignalBetween : public chart::Data {
+  public:
+    double x0, dx;
+    std::vector<double> y1, y2;
+    std::function<void (double&, double&, std::vector<double>&, std::vector<double>&)> fill;
+      
+    template<typename FILL>
+    SignalBetween(const std::string& arglist,
+		  const FILL& f) : chart::Data(arglist), x0(0), dx(1), y1(), y2(), fill(f) {}
+    virtual ~SignalBetween() {}
+      
+    virtual chart::Element* clone() const {
+      SignalBetween* res = new SignalBetween(args,fill);
+      res->x0 = x0;
+      res->dx = dx;
+      res->y1 = y1;
+      res->y2 = y2;
+      return res;
+    }
+
+    virtual void refill() {
+      fill(x0, dx, y1, y2);
+    }
+			    
+    virtual void _print_data(std::ostream& os) {
+      std::size_t first, last;
+      internal::visible_samples(x0, dx, std::min(y1.size(), y2.size()), viewport, first, last);
+      internal::print_sampling(os, x0, dx, first, last);
+      internal::print_samples(os, y1, first, last);
+      internal::print_samples(os, y2, first, last);
+    }
+
+    virtual void plot_getdata(std::ostream& os) {
+      python::get_signal_between(os,suffix,args);
+    }
+
+    virtual void plot(std::ostream& os) {
+      python::plot_signal_between(os,suffix);
+    }
+      
+  };
+
+  /**
+   * f(x0, dx, y1, y2) sets the bounds y1[i] and y2[i] of the area at x0 + i*dx.
+   */
+  template<typename FILL>
+  SignalBetween signal_between(const std::string& arglist,const FILL& f) {
+    return SignalBetween(arglist,f);
+  }
+
+
+  /////////////////
+  //             //
+  // Strip chart //
+  //             //
+  /////////////////
+
+  // This displays a stats::Strip that you feed with samples in your
+  // own code. Only the samples pushed since the previous frame are
+  // sent, the viewer keeps its own copy of the ring buffer. The strip
+  // has to live as long as the display, and should be displayed by a
+  // single element.
+
+  class StripChart : public chart::Data {
+  public:
+
+    stats::Strip& strip;
+      
+    StripChart(const std::string& arglist, stats::Strip& strip) 
+      : chart::Data(arglist), strip(strip) {}
+    virtual ~StripChart() {}
+      
+    virtual void _print_data(std::ostream& os) {
+      std::size_t first = strip.size() - strip.pending;
+      os << strip.capacity << ' ' << strip.reset << std::endl;
+      // Times are sent with full precision, they may be large.
+      auto precision = os.precision(std::numeric_limits<double>::max_digits10);
+      for(std::size_t i = first; i < strip.size(); ++i)
+	os << ' ' << strip[i].x;
+      os << std::endl;
+      os.precision(precision);
+      for(std::size_t i = first; i < strip.size(); ++i)
+	os << ' ' << strip[i].y;
+      os << std::endl;
+      strip.next_frame();
+    }
+
+    virtual chart::Element* clone() const {
+      return new StripChart(args, strip);
+    }
+
+    virtual void refill() {}
+
+    virtual void plot_getdata(std::ostream& os) {
+      python::get_strip(os,suffix);
+    }
+
+    virtual void plot(std::ostream& os) {
+      python::plot_strip(os,suffix,args);
+    }
+  };
+
+  /**
+   * The args are the ones of matplotlib plot.
+   */
+  inline StripChart strip_chart(const std::string& arglist, stats::Strip& strip) {
+    return StripChart(arglist, strip);
+  }
+
+
+  //////////////////
+  //              //
+  // Accumulation //
+  //              //
+  //////////////////
+
+  // This displays a stats::Scatter that you feed with points in your
+  // own code. Only the points added or replaced since the previous
+  // frame are sent, the viewer keeps the whole set. The scatter has to
+  // live as long as the display, and should be displayed by a single
+  // element.
+
+  class Accumulation : public chart::Data {
+  public:
+
+    stats::Scatter& scatter;
+      
+    Accumulation(const std::string& arglist, stats::Scatter& scatter) 
+      : chart::Data(arglist), scatter(scatter) {}
+    virtual ~Accumulation() {}
+      
+    virtual void _print_data(std::ostream& os) {
+      auto& points = scatter.points;
+      os << scatter.reset << std::endl;
+      for(std::size_t i = scatter.sent; i < points.size(); ++i) os << ' ' << points[i].x;
+      os << std::endl;
+      for(std::size_t i = scatter.sent; i < points.size(); ++i) os << ' ' << points[i].y;
+      os << std::endl;
+      for(auto i : scatter.replaced) os << ' ' << i;
+      os << std::endl;
+      for(auto i : scatter.replaced) os << ' ' << points[i].x;
+      os << std::endl;
+      for(auto i : scatter.replaced) os << ' ' << points[i].y;
+      os << std::endl;
+      scatter.next_frame();
+    }
+
+    virtual chart::Element* clone() const {
+      return new Accumulation(args, scatter);
+    }
+
+    virtual void refill() {}
+
+    virtual void plot_getdata(std::ostream& os) {
+      python::get_accumulation(os,suffix,args);
+    }
+
+    virtual void plot(std::ostream& os) {
+      python::plot_accumulation(os,suffix);
+    }
+  };
+
+  /**
+   * The args are the ones of matplotlib scatter.
+   */
+  inline Accumulation accumulation(const std::string& arglist, stats::Scatter& scatter) {
+    return Accumulation(arglist, scatter);
+  }
+
+
+  ///////////////
+  //           //
+  // Waterfall //
+  //           //
+  ///////////////
+
+  // This displays a stats::Waterfall that you feed with rows in your
+  // own code. Only the rows pushed since the previous frame are sent,
+  // the viewer scrolls its image. The waterfall has to live as long as
+  // the display, and should be displayed by a single element.
+
+  class WaterfallImage : public chart::Data {
+  public:
+
+    stats::Waterfall& waterfall;
+      
+    WaterfallImage(const std::string& arglist, stats::Waterfall& waterfall) 
+      : chart::Data(arglist), waterfall(waterfall) {}
+    virtual ~WaterfallImage() {}
+      
+    virtual void _print_data(std::ostream& os) {
+      os << waterfall.nb_rows << ' ' << waterfall.width << ' ' << waterfall.x_min << ' ' << waterfall.x_max << std::endl
+	 << waterfall.pending << ' ' << waterfall.reset << std::endl;
+      for(unsigned int i = waterfall.count - waterfall.pending; i < waterfall.count; ++i)
+	for(auto it = waterfall.row(i), end = it + waterfall.width; it != end; ++it)
+	  os << ' ' << *it;
+      os << std::endl;
+      waterfall.next_frame();
+    }
+
+    virtual chart::Element* clone() const {
+      return new WaterfallImage(args, waterfall);
+    }
+
+    virtual void refill() {}
+
+    virtual void plot_getdata(std::ostream& os) {
+      python::get_waterfall(os,suffix,args);
+    }
+
+    virtual void plot(std::ostream& os) {
+      python::plot_waterfall(os,suffix);
+    }
+  };
+
+  /**
+   * The newest row is at the top, at y = 0, and the oldest one at the bottom, at y = -nb_rows. The args are the ones of matplotlib imshow, except aspect which is 'auto'. Unless vmin or vmax is given, the colors are scaled on the rows displayed.
+   */
+  inline WaterfallImage waterfall(const std::string& arglist, stats::Waterfall& waterfall) {
+    return WaterfallImage(arglist, waterfall);
+  }
+
+
+  ///////////////////
+  //               //
+  // Distributions //
+  //               //
+  ///////////////////
+
+  /**
+   * ccmpl::summary::box draws box plots (median, quartiles, and whiskers at the extreme values within 1.5 interquartile range), ccmpl::summary::violin draws violin plots whose densities are derived from the quantile sketch.
+   */
+  enum class summary : char {box, violin};
+
+  // This displays the distributions of stats::Digest sketches that you
+  // feed with samples in your own code, one per category, at x = 1, 2,
+  // ... Only a few quantiles are sent. The digests have to live as
+  // long as the display.
+
+  class Distributions : public chart::Data {
+  public:
+
+    std::vector<stats::Digest>& digests;
+    summary shape;
+    unsigned int nb_coords; //!< The number of points of the violin outlines.
+      
+    Distributions(const std::string& arglist, std::vector<stats::Digest>& digests, summary shape, unsigned int nb_coords) 
+      : chart::Data(arglist), digests(digests), shape(shape), nb_coords(std::max(nb_coords, 3u)) {}
+    virtual ~Distributions() {}
+
+    void print_box(std::ostream& os, unsigned int pos, stats::Digest& digest) {
+      double q1  = digest.quantile(.25);
+      double med = digest.quantile(.5);
+      double q3  = digest.quantile(.75);
+      double iqr = q3 - q1;
+      // The whiskers are the extreme values within the fences, the
+      // sketch approximates them by the quantiles at the fences.
+      double lo = std::max(digest.min, q1 - 1.5*iqr);
+      double hi = std::min(digest.max, q3 + 1.5*iqr);
+      if(lo > digest.min) lo = digest.quantile(digest.cdf(lo));
+      if(hi < digest.max) hi = digest.quantile(digest.cdf(hi));
+      os << pos << ' ' << lo << ' ' << q1 << ' ' << med << ' ' << q3 << ' ' << hi << ' ' << digest.mean() << std::endl;
+    }
+
+    void print_violin(std::ostream& os, unsigned int pos, stats::Digest& digest) {
+      os << pos << ' ' << digest.min << ' ' << digest.max << ' ' << digest.quantile(.5) << ' ' << digest.mean() << std::endl;
+      double step = (digest.max - digest.min)/(nb_coords - 1);
+      for(unsigned int i = 0; i < nb_coords; ++i)
+	os << ' ' << digest.min + i*step;
+      os << std::endl;
+      // The density is the slope of the cdf, over two steps.
+      for(unsigned int i = 0; i < nb_coords; ++i) {
+	double lo = digest.min + (i == 0 ? 0 : i - 1)*step;
+	double hi = digest.min + (i + 1 == nb_coords ? i : i + 1)*step;
+	os << ' ' << (hi > lo ? (digest.cdf(hi) - digest.cdf(lo))/(hi - lo) : 0);
+      }
+      os << std::endl;
+    }
+      
+    virtual void _print_data(std::ostream& os) {
+      unsigned int nb = 0;
+      for(auto& d : digests) if(d.count() > 0) ++nb;
+      os << nb << std::endl;
+      unsigned int pos = 0;
+      for(auto& d : digests) {
+	++pos;
+	if(d.count() == 0) continue;
+	if(shape == summary::box) print_box(os, pos, d);
+	else                      print_violin(os, pos, d);
+      }
+    }
+
+    virtual chart::Element* clone() const {
+      return new Distributions(args, digests, shape, nb_coords);
+    }
+
+    virtual void refill() {}
+
+    virtual void plot_getdata(std::ostream& os) {
+      if(shape == summary::box) python::get_boxes(os,suffix,args);
+      else                      python::get_violins(os,suffix,args);
+    }
+
+    virtual void plot(std::ostream& os) {
+      python::plot_distributions(os,suffix);
+    }
+  };
+
+  /**
+   * The args are the ones of matplotlib bxp or violin.
+   */
+  inline Distributions distributions(const std::string& arglist, std::vector<stats::Digest>& digests, summary shape, unsigned int nb_coords = 64) {
+    return Distributions(arglist, digests, shape, nb_coords);
+  }
+
 
   /////////////
   //         //
@@ -471,9 +1380,70 @@ namespace ccmpl {
   //         //
   /////////////
 
+  namespace internal {
+    // This is the value given to the keyword name in the args of
+    // quiver, unquoted, or an empty string if the keyword is not set.
+    inline std::string quiver_keyword(const std::string& args, const std::string& name) {
+      for(auto pos = args.find(name); pos != std::string::npos; pos = args.find(name, pos + 1)) {
+	if(pos > 0 && (std::isalnum((unsigned char)args[pos-1]) || args[pos-1] == '_')) continue;
+	auto eq = args.find_first_not_of(" \t", pos + name.size());
+	if(eq == std::string::npos || args[eq] != '=') continue;
+	auto begin = args.find_first_not_of(" \t", eq + 1);
+	if(begin == std::string::npos) return "";
+	auto end = begin;
+	int depth = 0;
+	char quote = 0;
+	for(; end < args.size(); ++end) {
+	  char c = args[end];
+	  if(quote)                           {if(c == quote) quote = 0;}
+	  else if(c == '\'' || c == '"')      quote = c;
+	  else if(c == '(' || c == '[' || c == '{') ++depth;
+	  else if(c == ')' || c == ']' || c == '}') --depth;
+	  else if(c == ',' && depth == 0)     break;
+	}
+	while(end > begin && std::isspace((unsigned char)args[end-1])) --end;
+	if(end - begin >= 2 && (args[begin] == '\'' || args[begin] == '"') && args[end-1] == args[begin]) {
+	  ++begin;
+	  --end;
+	}
+	return args.substr(begin, end - begin);
+      }
+      return "";
+    }
+
+    // When the args of quiver draw the arrows in data units
+    // (scale_units='xy', angles='xy' and a numerical scale s), the
+    // arrow v at o is the segment [o + a*v/s, o + b*v/s], with [a,b]
+    // depending on the pivot. This returns false otherwise, e.g. when
+    // matplotlib autoscales the arrows.
+    inline bool quiver_segment(const std::string& args, double& a, double& b) {
+      if(quiver_keyword(args, "scale_units") != "xy" || quiver_keyword(args, "angles") != "xy")
+	return false;
+      double s;
+      try {
+	std::size_t end;
+	std::string scale = quiver_keyword(args, "scale");
+	s = std::stod(scale, &end);
+	if(end != scale.size() || !(s > 0) || !std::isfinite(s)) return false;
+      }
+      catch(const std::exception&) {
+	return false;
+      }
+      std::string pivot = quiver_keyword(args, "pivot");
+      if(pivot == "" || pivot == "tail")           {a =  0;  b = 1; }
+      else if(pivot == "mid" || pivot == "middle") {a = -.5; b = .5;}
+      else if(pivot == "tip")                      {a = -1;  b = 0; }
+      else return false;
+      a /= s;
+      b /= s;
+      return true;
+    }
+  }
+
   class Vectors : public chart::Data {
   public:
     std::vector<std::pair<Point,Point>> vectors; // origin, vector.
+    std::vector<std::pair<Point,Point>> visible;
 
     std::function<void (std::vector<std::pair<Point,Point>>&)> fill;
       
@@ -481,6 +1451,7 @@ namespace ccmpl {
     Vectors(const std::string& arglist,
 	    const FILL& f) 
       : chart::Data(arglist), 
+      visible(),
       fill(f) {}
     virtual ~Vectors() {}
       
@@ -489,6 +1460,22 @@ namespace ccmpl {
     }
 
     virtual void _print_data(std::ostream& os) {
+      double a, b;
+      if(viewport.culls() && internal::quiver_segment(args, a, b)) {
+	// Only the arrows whose drawn segment overlaps the view are sent.
+	algo::select(vectors.begin(), vectors.end(),
+		     [this, a, b](const std::pair<Point,Point>& v) {
+		       return viewport.overlaps(v.first.x + a*v.second.x, v.first.x + b*v.second.x,
+						v.first.y + a*v.second.y, v.first.y + b*v.second.y);
+		     },
+		     visible);
+	print_vectors(os, visible);
+      }
+      else
+	print_vectors(os, vectors);
+    }
+
+    static void print_vectors(std::ostream& os, const std::vector<std::pair<Point,Point>>& vectors) {
       for(auto& v : vectors) 
 	os << ' ' << v.first.x;
       os << std::endl;
@@ -519,6 +1506,9 @@ namespace ccmpl {
       
   };
 
+  /**
+   * With ccmpl::culling::view and fixed view limits, only the arrows overlapping the view are sent, provided that the args make quiver draw them in data units: "angles='xy', scale_units='xy', scale=s", s being a number. The pivot ('tail', 'mid' or 'tip') is taken into account. With other args (e.g. when matplotlib scales the arrows automatically, from all the arrows it gets), all the arrows are sent.
+   */
   template<typename FILL>
   Vectors vectors(const std::string& arglist,
 		  const FILL& f) {
@@ -537,6 +1527,9 @@ namespace ccmpl {
   public:
     std::vector<ValueAt> points;
     double min,max;
+    rendering mode;
+    double max_gap; //!< The extent of the interpolation with ccmpl::rendering::raster, see algo::rasterize.
+    std::vector<double> raster;
 
     std::function<void (std::vector<ValueAt>&)> fill;
       
@@ -544,10 +1537,15 @@ namespace ccmpl {
     Surface(const std::string& arglist,
 	    double min_value,
 	    double max_value,
-	    const FILL& f) 
+	    const FILL& f,
+	    rendering mode = rendering::viewer,
+	    double max_gap = 2) 
       : chart::Data(arglist), 
       min(min_value),
       max(max_value),
+      mode(mode),
+      max_gap(max_gap),
+      raster(),
       fill(f) {}
     virtual ~Surface() {}
       
@@ -556,6 +1554,15 @@ namespace ccmpl {
     }
 
     virtual void _print_data(std::ostream& os) {
+      if(mode == rendering::raster) {
+	auto frame = internal::raster_frame(points.begin(), points.end(), viewport);
+	algo::rasterize(points, frame, raster, max_gap);
+	internal::print_frame(os, frame);
+	for(auto v : raster)
+	  os << ' ' << v;
+	os << std::endl;
+	return;
+      }
       for(auto& pt : points) 
 	os << ' ' << pt.x;
       os << std::endl;
@@ -568,13 +1575,16 @@ namespace ccmpl {
     }
 
     virtual chart::Element* clone() const {
-      Surface* res = new Surface(args,min,max,fill);
+      Surface* res = new Surface(args,min,max,fill,mode,max_gap);
       res->points = points;
       return res;
     }
 
     virtual void plot_getdata(std::ostream& os) {
-      python::get_surface(os,suffix,args,min,max);
+      if(mode == rendering::raster)
+	python::get_raster(os,suffix,args,min,max);
+      else
+	python::get_surface(os,suffix,args,min,max);
     }
 
     virtual void plot(std::ostream& os) {
@@ -591,6 +1601,19 @@ namespace ccmpl {
     return Surface(arglist,min_value,max_value,f);
   }
 
+  /**
+   * With ccmpl::rendering::raster, the args are the ones of matplotlib imshow (cmap, interpolation...). The pixels with no sample are interpolated, unless they are farther than max_gap times the average spacing of the samples from any of them: those are left transparent, as outside of the triangulation drawn by ccmpl::rendering::viewer. Pass std::numeric_limits<double>::infinity() to fill the whole bounding box of the samples.
+   */
+  template<typename FILL>
+  Surface surface(const std::string& arglist,
+		  double min_value,
+		  double max_value,
+		  const FILL& f,
+		  rendering mode,
+		  double max_gap = 2) {
+    return Surface(arglist,min_value,max_value,f,mode,max_gap);
+  }
+
   /////////////
   //         //
   // Palette //
@@ -658,11 +1681,23 @@ namespace ccmpl {
     std::vector<ColorAt> points;
     std::function<void (std::vector<ColorAt>&)> fill;
       
+    rendering mode;
+    std::vector<double> acc;
+      
     template<typename FILL>
-    Confetti(const std::string& arglist, const FILL& f) : chart::Data(arglist), fill(f) {}
+    Confetti(const std::string& arglist, const FILL& f, rendering mode = rendering::viewer) : chart::Data(arglist), fill(f), mode(mode), acc() {}
     virtual ~Confetti() {}
       
     virtual void _print_data(std::ostream& os) {
+      if(mode == rendering::raster) {
+	auto frame = internal::raster_frame(points.begin(), points.end(), viewport);
+	algo::splat<3>(points.begin(), points.end(), frame,
+		       [](const ColorAt& pt, double* rgb) {rgb[0] = pt.color.r; rgb[1] = pt.color.g; rgb[2] = pt.color.b;},
+		       acc);
+	internal::print_frame(os, frame);
+	internal::print_blend(os, acc);
+	return;
+      }
       for(auto& pt : points) 
 	os << ' ' << pt.x;
       os << std::endl;
@@ -678,7 +1713,7 @@ namespace ccmpl {
     }
 
     virtual chart::Element* clone() const {
-      Confetti* res = new Confetti(args,fill);
+      Confetti* res = new Confetti(args,fill,mode);
       res->points = points;
       return res;
     }
@@ -688,7 +1723,10 @@ namespace ccmpl {
     }
 
     virtual void plot_getdata(std::ostream& os) {
-      python::get_confetti(os,suffix,args);
+      if(mode == rendering::raster)
+	python::get_blend(os,suffix,"confetti",args);
+      else
+	python::get_confetti(os,suffix,args);
     }
 
     virtual void plot(std::ostream& os) {
@@ -702,6 +1740,38 @@ namespace ccmpl {
     return Confetti(arglist,f);
   }
 
+  /**
+   * With ccmpl::rendering::raster, each pixel shows the average color of its points, and the args are the ones of matplotlib imshow. Empty pixels are transparent.
+   */
+  template<typename FILL>
+  Confetti confetti(const std::string& arglist, const FILL& f, rendering mode) {
+    return Confetti(arglist,f,mode);
+  }
+
+
+  namespace internal {
+    
+    /**
+     * This sends the nb+1 edges of the bins regularly spread over [min,max[.
+     */
+    inline void print_edges(std::ostream& os, double min, double max, unsigned int nb) {
+      double coef = (max - min)/nb;
+      for(unsigned int b = 0; b <= nb; ++b)
+	os << ' ' << min + b*coef;
+      os << std::endl;
+    }
+    
+    template<typename COUNTS>
+    void print_histo1d(std::ostream& os, double min, double max, unsigned int nb, const COUNTS& h) {
+      // Bin edges are sent rather than centers and width, so that the
+      // viewer follows the range of auto-ranged histograms.
+      print_edges(os, min, max, nb);
+
+      for(auto bar : h)
+	os << ' ' << bar;
+      os << std::endl;
+    }
+  }
 
   /////////////
   //         //
@@ -729,27 +1799,11 @@ namespace ccmpl {
     virtual ~Histo1d() {}
       
     virtual void _print_data(std::ostream& os) {
-      double coef = (max - min)/nb;
-      double norm = 1/coef;
-
-      // bar width
-      os << coef << std::endl;
-      
-      // bin centers
-      for(unsigned int b = 0; b < nb; ++b)
-	os << ' ' << min + (b+.5)*coef;
-      os << std::endl;
-
       // Histogram computation
       std::vector<unsigned int> h(nb, 0);
-      for(auto d : data)
-	if(min <= d && d < max)
-	  ++(h[(int)((d-min)*norm)]);
+      algo::histogram(data.begin(), data.end(), nb, algo::Index1d(min, max, nb), h);
 
-      for(auto bar : h)
-	os << ' ' << bar;
-      os << std::endl;
-      
+      internal::print_histo1d(os, min, max, nb, h);
     }
 
     virtual chart::Element* clone() const {
@@ -813,23 +1867,11 @@ namespace ccmpl {
       
     virtual void _print_data(std::ostream& os) {
       std::vector<unsigned int> hits(nbx*nby,0);
-      for(auto& pt : data) {
-	if(pt.x >= x_min && pt.y >= y_min
-	   && pt.x < x_max && pt.y < y_max) {
-	  unsigned int w = (unsigned int)((pt.x-x_min)*nbx/(x_max-x_min));
-	  unsigned int h = (unsigned int)((pt.y-y_min)*nby/(y_max-y_min));
-	  ++(hits[w+h*nbx]);
-	}
-      }
+      algo::histogram(data.begin(), data.end(), nbx*nby,
+		      algo::Index2d(x_min, x_max, nbx, y_min, y_max, nby),
+		      hits);
 
-      for(unsigned int h = 0 ; h < nby ; ++h) {
-	for(unsigned int w = 0 ; w < nbx ; ++w) 
-	  os << ' ' << hits[w + h*nbx];
-	os << " 0";
-      }
-      for(unsigned int w = 0 ; w <= nbx ; ++w)
-	os << " 0";
-      os << std::endl;
+      internal::print_counts(os, hits);
     }
 
     virtual chart::Element* clone() const {
@@ -895,21 +1937,11 @@ namespace ccmpl {
       
     virtual void _print_data(std::ostream& os) {
       std::vector<unsigned int> hits(nbx*nby,0);
-      for(auto& pt : data) {
-	if(pt.x >= x_min && pt.y >= y_min
-	   && pt.x < x_max && pt.y < y_max) {
-	  unsigned int w = (unsigned int)((pt.x-x_min)*nbx/(x_max-x_min));
-	  unsigned int h = (unsigned int)((pt.y-y_min)*nby/(y_max-y_min));
-	  ++(hits[w+h*nbx]);
-	}
-      }
+      algo::histogram(data.begin(), data.end(), nbx*nby,
+		      algo::Index2d(x_min, x_max, nbx, y_min, y_max, nby),
+		      hits);
 
-      for(auto hit : hits) 
-	if(hit != 0)
-	  os << ' ' << hit;
-	else
-	  os << ' ' << .01;
-      os << std::endl;
+      internal::print_counts(os, hits);
     }
 
     virtual chart::Element* clone() const {
@@ -946,6 +1978,213 @@ namespace ccmpl {
   }
 
 
+  ////////////
+  //        //
+  // Hexbin // 
+  //        //
+  ////////////
+
+  // Points are counted in C++ in the cells of a hexagonal lattice (see
+  // algo::HexIndex), the viewer only colors a collection of hexagons
+  // that is built once.
+
+  class Hexbin : public chart::Data {
+  public:
+
+    std::function<void (std::vector<Point>&)> fill;
+    std::vector<Point> data;
+    double x_min, x_max;
+    unsigned int nx;
+    double y_min, y_max;
+    unsigned int ny;
+      
+      
+    template<typename FILL>
+    Hexbin(const std::string& arglist, 
+	   const FILL& f,
+	   double xmin, double xmax, unsigned int nx,
+	   double ymin, double ymax, unsigned int ny) 
+      : chart::Data(arglist), fill(f),
+      data(),
+      x_min(xmin), x_max(xmax), nx(nx),
+      y_min(ymin), y_max(ymax), ny(ny){}
+    virtual ~Hexbin() {}
+      
+    virtual void _print_data(std::ostream& os) {
+      algo::HexIndex index(x_min, x_max, nx, y_min, y_max, ny);
+      std::vector<unsigned int> hits(index.size(),0);
+      algo::histogram(data.begin(), data.end(), index.size(), index, hits);
+
+      internal::print_counts(os, hits);
+    }
+
+    virtual chart::Element* clone() const {
+      Hexbin* res = new Hexbin(args,fill,
+			       x_min,x_max,nx,
+			       y_min,y_max,ny);
+      res->data = data;
+      return res;
+    }
+
+    virtual void refill() {
+      fill(data);
+    }
+
+    virtual void plot_getdata(std::ostream& os) {
+      python::get_hexbin(os,suffix,nx,ny);
+    }
+
+    virtual void plot(std::ostream& os) {
+      python::plot_hexbin(os,suffix,args,
+			  x_min,x_max,nx,
+			  y_min,y_max,ny);
+    }
+      
+  };
+
+  /**
+   * The lattice has nx cells along x. The number of cells along y is chosen so that the hexagons are regular when both axes have the same scale, as matplotlib does.
+   */
+  template<typename FILL>
+  Hexbin hexbin(const std::string& arglist, const FILL& f,
+		double xmin, double xmax, double ymin, double ymax,
+		unsigned int nx) {
+    unsigned int ny = std::max(1u, (unsigned int)(nx/std::sqrt(3.)));
+    return Hexbin(arglist,f,
+		  xmin,xmax,nx,
+		  ymin,ymax,ny);
+  }
+
+  template<typename FILL>
+  Hexbin hexbin(const std::string& arglist, const FILL& f,
+		double xmin, double xmax, unsigned int nx,
+		double ymin, double ymax, unsigned int ny) {
+    return Hexbin(arglist,f,
+		  xmin,xmax,nx,
+		  ymin,ymax,ny);
+  }
+
+
+  ////////////////////
+  //                //
+  // Histo*d Stream // 
+  //                //
+  ////////////////////
+
+  // These elements display the counts of a stats::Histogram1d or
+  // stats::Histogram2d that you feed with samples in your own
+  // code. Samples are not stored, the histogram has to live as long as
+  // the display. The bin edges are sent at each frame, since the range
+  // of auto-ranged histograms grows with the samples.
+
+  class Histo1dStream : public chart::Data {
+  public:
+
+    stats::Histogram1d& histogram;
+      
+    Histo1dStream(const std::string& arglist, stats::Histogram1d& histogram) 
+      : chart::Data(arglist), histogram(histogram) {}
+    virtual ~Histo1dStream() {}
+      
+    virtual void _print_data(std::ostream& os) {
+      internal::print_histo1d(os, histogram.min, histogram.max, histogram.nb, histogram.counts);
+      histogram.next_frame();
+    }
+
+    virtual chart::Element* clone() const {
+      return new Histo1dStream(args, histogram);
+    }
+
+    virtual void refill() {}
+
+    virtual void plot_getdata(std::ostream& os) {
+      python::get_histo1d(os,suffix, args);
+    }
+
+    virtual void plot(std::ostream& os) {
+      python::plot_histo1d(os,suffix);
+    }
+  };
+
+  inline Histo1dStream histo1d(const std::string& arglist, stats::Histogram1d& histogram) {
+    return Histo1dStream(arglist, histogram);
+  }
+
+  class Histo2dStream : public chart::Data {
+  public:
+
+    stats::Histogram2d& histogram;
+      
+    Histo2dStream(const std::string& arglist, stats::Histogram2d& histogram) 
+      : chart::Data(arglist), histogram(histogram) {}
+    virtual ~Histo2dStream() {}
+      
+    virtual void _print_data(std::ostream& os) {
+      internal::print_edges(os, histogram.x_min, histogram.x_max, histogram.nbx);
+      internal::print_edges(os, histogram.y_min, histogram.y_max, histogram.nby);
+      internal::print_counts(os, histogram.counts);
+      histogram.next_frame();
+    }
+
+    virtual chart::Element* clone() const {
+      return new Histo2dStream(args, histogram);
+    }
+
+    virtual void refill() {}
+
+    virtual void plot_getdata(std::ostream& os) {
+      python::get_histo2d(os,suffix,args,histogram.nbx,histogram.nby,true);
+    }
+
+    virtual void plot(std::ostream& os) {
+      python::plot_histo2d(os,suffix,
+			   histogram.x_min,histogram.x_max,histogram.nbx,
+			   histogram.y_min,histogram.y_max,histogram.nby);
+    }
+  };
+
+  inline Histo2dStream histo2d(const std::string& arglist, stats::Histogram2d& histogram) {
+    return Histo2dStream(arglist, histogram);
+  }
+
+  class Histo3dStream : public chart::Data {
+  public:
+
+    stats::Histogram2d& histogram;
+      
+    Histo3dStream(const std::string& arglist, stats::Histogram2d& histogram) 
+      : chart::Data(arglist), histogram(histogram) {}
+    virtual ~Histo3dStream() {}
+      
+    virtual void _print_data(std::ostream& os) {
+      internal::print_edges(os, histogram.x_min, histogram.x_max, histogram.nbx);
+      internal::print_edges(os, histogram.y_min, histogram.y_max, histogram.nby);
+      internal::print_counts(os, histogram.counts);
+      histogram.next_frame();
+    }
+
+    virtual chart::Element* clone() const {
+      return new Histo3dStream(args, histogram);
+    }
+
+    virtual void refill() {}
+
+    virtual void plot_getdata(std::ostream& os) {
+      python::get_histo3d(os,suffix,args,true);
+    }
+
+    virtual void plot(std::ostream& os) {
+      python::plot_histo3d(os,suffix,
+			   histogram.x_min,histogram.x_max,histogram.nbx,
+			   histogram.y_min,histogram.y_max,histogram.nby);
+    }
+  };
+
+  inline Histo3dStream histo3d(const std::string& arglist, stats::Histogram2d& histogram) {
+    return Histo3dStream(arglist, histogram);
+  }
+
+
   /////////////
   //         //
   // Patches //
@@ -982,14 +2221,18 @@ namespace ccmpl {
     }
 
     virtual void _print_data(std::ostream& os) {
+      double xmin = viewport.x_fixed ? viewport.xmin : -HUGE_VAL;
+      double xmax = viewport.x_fixed ? viewport.xmax :  HUGE_VAL;
+      double ymin = viewport.y_fixed ? viewport.ymin : -HUGE_VAL;
+      double ymax = viewport.y_fixed ? viewport.ymax :  HUGE_VAL;
+      bool first = true;
       os << "tmp = [";
-      auto patch = patches.begin();
-      if(patch != patches.end())
-	(*(patch++))->toPython(os);
-      while(patch != patches.end()) {
-	os << ", ";
-	(*(patch++))->toPython(os);
-      }
+      for(auto& patch : patches) 
+	if(!viewport.culls() || patch->intersects(xmin, xmax, ymin, ymax)) {
+	  if(!first) os << ", ";
+	  patch->toPython(os);
+	  first = false;
+	}
       os << ']' << std::endl;
     }
   };
@@ -1008,19 +2251,75 @@ namespace ccmpl {
   /////////////
 
   
+  /**
+   * ccmpl::resolution::full sends the image as it is, ccmpl::resolution::display sends the coarsest level of a mipmap pyramid that still has at least as many pixels as the visible part of the image has on the subplot. When the limits are fixed (by ccmpl::view2d or by a zoom in the viewer), whatever the ccmpl::culling mode, the level is chosen for the visible part only, so that zooming in sends finer levels, and only that part is sent.
+   */
+  enum class resolution : char {full, display};
+
+  /**
+   * ccmpl::update::full sends the whole image at each frame, ccmpl::update::tiles only sends the tiles that differ from the previously sent frame.
+   */
+  enum class update : char {full, tiles};
+
+  /**
+   * This collects the areas of an image that have been modified. Give it to ccmpl::image and to your fill function (with std::ref), and mark the areas you change there. Only the tiles covering these areas are then sent, without comparing the image to the previous frame.
+   */
+  class DirtyRects {
+  public:
+    struct Rect {
+      unsigned int col, row, width, height;
+    };
+    
+    std::vector<Rect> rects;
+    bool all;
+
+    DirtyRects() : rects(), all(true) {}
+    DirtyRects(const DirtyRects&)            = delete;
+    DirtyRects& operator=(const DirtyRects&) = delete;
+
+    void mark_dirty(const Rect& r) {
+      rects.push_back(r);
+    }
+
+    void mark_all() {
+      all = true;
+    }
+
+    void clear() {
+      rects.clear();
+      all = false;
+    }
+  };
+  
   class Image : public chart::Data {
   public:
 
+    // A reduced version of the image.
+    struct Level {
+      std::vector<double> x, y, z;
+      unsigned int width;
+    };
+
     // x and y are 1D 
     // z is a vectorized matrix which can contain Gray (depth=1) or RGB (depth=3) values
     std::vector<double> x, y, z;
     unsigned int width;
     unsigned int depth;
+    resolution display_resolution;
+    std::vector<Level> pyramid; // pyramid[k] is 2^(k+1) times smaller than the image.
+    update updates;
+    DirtyRects* marks;
+    unsigned int tile_size;
     std::function<void (std::vector<double>&, std::vector<double>&, std::vector<double>&, unsigned int&, unsigned int&)> fill;
       
     template<typename FILL>
     Image(const std::string& arglist, 
-	  const FILL& f) : chart::Data(arglist), fill(f) {}
+	  const FILL& f,
+	  resolution r = resolution::full,
+	  update u = update::full,
+	  DirtyRects* marks = nullptr) : chart::Data(arglist), display_resolution(r), pyramid(),
+					 updates(marks == nullptr ? u : update::tiles), marks(marks), tile_size(32),
+					 fill(f), sent_x(), sent_y(), sent_z(), sent_width(0) {}
     virtual ~Image() {}
 
     virtual void refill() {
@@ -1028,7 +2327,7 @@ namespace ccmpl {
     }
 
     virtual Element* clone() const {
-      Image* res = new Image(args, fill);
+      Image* res = new Image(args, fill, display_resolution, updates, marks);
       res->x = x;
       res->y = y;
       res->z = z;
@@ -1038,14 +2337,228 @@ namespace ccmpl {
     }
       
     virtual void plot_getdata(std::ostream& os) {
-      python::get_image(os,suffix);
+      // When the image is cropped to the view, the limits must not
+      // follow it.
+      python::get_image(os,suffix,display_resolution == resolution::display);
     }
       
     virtual void plot(std::ostream& os) {
       python::plot_image(os,suffix, args);
     }
 
+    /**
+     * This computes dst as src reduced by a factor of 2 in each direction, with area-average. Rows are handled in parallel.
+     */
+    static void halve(const std::vector<double>& src_x, const std::vector<double>& src_y, const std::vector<double>& src_z,
+		      unsigned int src_width, unsigned int depth,
+		      Level& dst) {
+      unsigned int src_height = src_z.size()/(src_width*depth);
+      unsigned int w          = (src_width  + 1)/2;
+      unsigned int h          = (src_height + 1)/2;
+
+      // Odd sizes are handled by duplicating the last row/column, which
+      // keeps the average right.
+      dst.width = w;
+      dst.x.resize(w);
+      dst.y.resize(h);
+      dst.z.resize(w*h*depth);
+      for(unsigned int j = 0; j < w; ++j)
+	dst.x[j] = .5*(src_x[2*j] + src_x[std::min(2*j+1, src_width-1)]);
+      for(unsigned int i = 0; i < h; ++i)
+	dst.y[i] = .5*(src_y[2*i] + src_y[std::min(2*i+1, src_height-1)]);
+
+      internal::parallel_for(h, internal::grain_for(4*w*depth),
+			     [&src_z, &dst, src_width, src_height, w, depth](unsigned int, std::size_t begin, std::size_t end) {
+			       for(std::size_t i = begin; i < end; ++i) {
+				 const double* row0 = src_z.data() + (2*i)*src_width*depth;
+				 const double* row1 = src_z.data() + std::min((unsigned int)(2*i+1), src_height-1)*src_width*depth;
+				 double* out = dst.z.data() + i*w*depth;
+				 for(unsigned int j = 0; j < w; ++j) {
+				   unsigned int j0 = (2*j)*depth;
+				   unsigned int j1 = std::min(2*j+1, src_width-1)*depth;
+				   for(unsigned int d = 0; d < depth; ++d)
+				     *(out++) = .25*(row0[j0+d] + row0[j1+d] + row1[j0+d] + row1[j1+d]);
+				 }
+			       }
+			     });
+    }
+
+    // This is the range [begin,end[ of the coordinates in [min,max],
+    // extended by one on each side.
+    static void visible_range(const std::vector<double>& coords, bool fixed, double min, double max,
+			      unsigned int& begin, unsigned int& end) {
+      begin = 0;
+      end   = coords.size();
+      if(!fixed) return;
+      unsigned int first = coords.size(), last = 0;
+      for(unsigned int i = 0; i < coords.size(); ++i)
+	if(coords[i] >= min && coords[i] <= max) {
+	  first = std::min(first, i);
+	  last  = i;
+	}
+      if(first > last) return; // Nothing visible, nothing is cropped.
+      begin = first == 0 ? 0 : first - 1;
+      end   = std::min(last + 2, (unsigned int)coords.size());
+    }
+
+    /**
+     * This builds the pyramid levels up to the one matching the viewport, and returns the number of halvings (0 means the full image). Only the visible part of the image is considered, so zooming in the viewer selects finer levels.
+     */
+    unsigned int select_level() {
+      unsigned int level = 0;
+      if(display_resolution != resolution::display || width == 0 || depth == 0 || z.size() == 0 || viewport.width == 0 || viewport.height == 0)
+	return level;
+      unsigned int col_begin, col_end, row_begin, row_end;
+      visible_range(x, viewport.x_fixed, viewport.xmin, viewport.xmax, col_begin, col_end);
+      visible_range(y, viewport.y_fixed, viewport.ymin, viewport.ymax, row_begin, row_end);
+      unsigned int w = width;
+      unsigned int h = z.size()/(width*depth);
+      unsigned int vw = col_end - col_begin;
+      unsigned int vh = row_end - row_begin;
+      while((vw+1)/2 >= viewport.width && (vh+1)/2 >= viewport.height && w > 1 && h > 1) {
+	if(pyramid.size() <= level) pyramid.emplace_back();
+	if(level == 0) halve(x, y, z, width, depth, pyramid[0]);
+	else {
+	  auto& src = pyramid[level-1];
+	  halve(src.x, src.y, src.z, src.width, depth, pyramid[level]);
+	}
+	w = pyramid[level].width;
+	h = pyramid[level].y.size();
+	vw = (vw+1)/2;
+	vh = (vh+1)/2;
+	++level;
+      }
+      return level;
+    }
+
     virtual void _print_data(std::ostream& os) {
+      unsigned int level = select_level();
+      const std::vector<double>* lx = &x;
+      const std::vector<double>* ly = &y;
+      const std::vector<double>* lz = &z;
+      unsigned int lw = width;
+      if(level != 0) {
+	auto& l = pyramid[level-1];
+	lx = &l.x; ly = &l.y; lz = &l.z; lw = l.width;
+      }
+
+      // Only the visible part is sent, when the view is known, since
+      // the level has been chosen for it. This is not done with
+      // DirtyRects, whose areas refer to the whole image.
+      if(display_resolution == resolution::display && (viewport.x_fixed || viewport.y_fixed) && marks == nullptr && lw != 0 && depth != 0) {
+	unsigned int col_begin, col_end, row_begin, row_end;
+	visible_range(*lx, viewport.x_fixed, viewport.xmin, viewport.xmax, col_begin, col_end);
+	visible_range(*ly, viewport.y_fixed, viewport.ymin, viewport.ymax, row_begin, row_end);
+	if(col_end - col_begin < lw || row_end - row_begin < ly->size()) {
+	  window.width = col_end - col_begin;
+	  window.x.assign(lx->begin() + col_begin, lx->begin() + col_end);
+	  window.y.assign(ly->begin() + row_begin, ly->begin() + row_end);
+	  window.z.clear();
+	  for(unsigned int i = row_begin; i < row_end; ++i) {
+	    auto row = lz->begin() + (i*lw + col_begin)*depth;
+	    window.z.insert(window.z.end(), row, row + window.width*depth);
+	  }
+	  lx = &window.x; ly = &window.y; lz = &window.z; lw = window.width;
+	}
+      }
+      print_image(os, *lx, *ly, *lz, lw, level);
+    }
+
+  private:
+
+    // What has been sent at last frame.
+    std::vector<double> sent_x, sent_y, sent_z;
+    unsigned int sent_width;
+
+    // The visible part of the image.
+    Level window;
+
+    // This tells which tiles of the image to be sent differ from what
+    // was sent at last frame. Tile rows are compared in parallel.
+    void compare_tiles(const std::vector<double>& z, unsigned int width, unsigned int height,
+		       unsigned int nb_cols, unsigned int nb_rows,
+		       std::vector<char>& dirty) {
+      unsigned int ts = tile_size;
+      unsigned int depth = this->depth;
+      internal::parallel_for(nb_rows, internal::grain_for(ts*width*depth),
+			     [this, &z, &dirty, width, height, nb_cols, ts, depth](unsigned int, std::size_t begin, std::size_t end) {
+			       for(std::size_t r = begin; r < end; ++r)
+				 for(unsigned int c = 0; c < nb_cols; ++c) {
+				   unsigned int col_begin = c*ts*depth;
+				   unsigned int col_end   = std::min((c+1)*ts, width)*depth;
+				   unsigned int row_end   = std::min((unsigned int)((r+1)*ts), height);
+				   bool changed = false;
+				   for(unsigned int i = r*ts; i < row_end && !changed; ++i)
+				     changed = !std::equal(z.begin()      + i*width*depth + col_begin, z.begin() + i*width*depth + col_end,
+							   sent_z.begin() + i*width*depth + col_begin);
+				   dirty[r*nb_cols + c] = changed;
+				 }
+			     });
+    }
+
+    // This flags the tiles covering the marked areas, expressed in the
+    // full resolution image, for an image halved level times.
+    void mark_tiles(unsigned int level, unsigned int width, unsigned int height,
+		    unsigned int nb_cols, unsigned int nb_rows,
+		    std::vector<char>& dirty) {
+      for(auto& rect : marks->rects) {
+	if(rect.width == 0 || rect.height == 0) continue;
+	unsigned int col_begin = rect.col >> level;
+	unsigned int row_begin = rect.row >> level;
+	unsigned int col_end   = std::min(((rect.col + rect.width  - 1) >> level) + 1, width);
+	unsigned int row_end   = std::min(((rect.row + rect.height - 1) >> level) + 1, height);
+	for(unsigned int r = row_begin/tile_size; r*tile_size < row_end && r < nb_rows; ++r)
+	  for(unsigned int c = col_begin/tile_size; c*tile_size < col_end && c < nb_cols; ++c)
+	    dirty[r*nb_cols + c] = 1;
+      }
+    }
+
+    void print_image(std::ostream& os,
+		     const std::vector<double>& x, const std::vector<double>& y, const std::vector<double>& z,
+		     unsigned int width, unsigned int level) {
+      bool full = updates == update::full
+	|| width != sent_width || z.size() != sent_z.size()
+	|| x != sent_x || y != sent_y
+	|| (marks != nullptr && marks->all);
+      
+      if(!full) {
+	unsigned int height  = z.size()/(width*depth);
+	unsigned int nb_cols = (width  + tile_size - 1)/tile_size;
+	unsigned int nb_rows = (height + tile_size - 1)/tile_size;
+	std::vector<char> dirty(nb_cols*nb_rows, 0);
+	if(marks == nullptr)
+	  compare_tiles(z, width, height, nb_cols, nb_rows, dirty);
+	else {
+	  mark_tiles(level, width, height, nb_cols, nb_rows, dirty);
+	  marks->clear();
+	}
+	
+	unsigned int nb_dirty = std::count(dirty.begin(), dirty.end(), 1);
+	if(2*nb_dirty <= dirty.size()) {
+	  os << "tiles " << nb_dirty << std::endl;
+	  for(unsigned int r = 0; r < nb_rows; ++r)
+	    for(unsigned int c = 0; c < nb_cols; ++c)
+	      if(dirty[r*nb_cols + c]) {
+		unsigned int row_begin = r*tile_size;
+		unsigned int col_begin = c*tile_size;
+		unsigned int h = std::min(row_begin + tile_size, height) - row_begin;
+		unsigned int w = std::min(col_begin + tile_size, width)  - col_begin;
+		os << row_begin << ' ' << col_begin << ' ' << h << ' ' << w;
+		for(unsigned int i = row_begin; i < row_begin + h; ++i) {
+		  auto begin = z.begin() + (i*width + col_begin)*depth;
+		  auto end   = begin + w*depth;
+		  for(auto it = begin; it != end; ++it)
+		    os << ' ' << *it;
+		  if(marks == nullptr)
+		    std::copy(begin, end, sent_z.begin() + (i*width + col_begin)*depth);
+		}
+		os << std::endl;
+	      }
+	  return;
+	}
+      }
+
+      os << "full" << std::endl;
       for(auto& xi : x) 
 	os << ' ' << xi;
       os << std::endl;
@@ -1056,6 +2569,18 @@ namespace ccmpl {
 	os << ' ' << zi;
       os << std::endl;
       os << width << ' ' << depth << std::endl;
+
+      if(updates == update::tiles) {
+	sent_x     = x;
+	sent_y     = y;
+	sent_width = width;
+	if(marks == nullptr)
+	  sent_z = z;
+	else {
+	  sent_z.resize(z.size());
+	  marks->clear();
+	}
+      }
     }
   };
 
@@ -1064,6 +2589,24 @@ namespace ccmpl {
     return Image(arglist, f);
   }
 
+  template<typename FILL>
+  Image image(const std::string& arglist, const FILL& f, resolution r) {
+    return Image(arglist, f, r);
+  }
+
+  template<typename FILL>
+  Image image(const std::string& arglist, const FILL& f, resolution r, update u) {
+    return Image(arglist, f, r, u);
+  }
+
+  /**
+   * The image is sent by tiles, only the ones covering the areas marked in dirty are sent. dirty has to live as long as the display.
+   */
+  template<typename FILL>
+  Image image(const std::string& arglist, const FILL& f, resolution r, DirtyRects& dirty) {
+    return Image(arglist, f, r, update::tiles, &dirty);
+  }
+
 
   //////////////
   //          //
@@ -1072,6 +2615,11 @@ namespace ccmpl {
   //////////////
 
   
+  /**
+   * ccmpl::extraction::viewer lets matplotlib compute the contours from the grid, ccmpl::extraction::cpp computes the isolines in C++ and only sends their segments.
+   */
+  enum class extraction : char {viewer, cpp};
+  
   class Contours : public chart::Data {
   public:
 
@@ -1082,6 +2630,8 @@ namespace ccmpl {
     double ymin; double ymax; unsigned int nb_y;
     double zmin; double zmax; unsigned int nb_z;
     unsigned int fontsize;
+    extraction mode;
+    std::vector<std::vector<algo::Segment>> segments;
     
     std::function<void (std::vector<double>& z,
 			double&, double&, unsigned int&,
@@ -1091,7 +2641,8 @@ namespace ccmpl {
     template<typename FILL>
     Contours(const std::string& arglist,
 	     unsigned int fontsize,
-	     const FILL& f) : chart::Data(arglist), fontsize(fontsize), fill(f) {}
+	     const FILL& f,
+	     extraction mode = extraction::viewer) : chart::Data(arglist), fontsize(fontsize), mode(mode), segments(), fill(f) {}
     virtual ~Contours() {}
 
     virtual void refill() {
@@ -1099,7 +2650,7 @@ namespace ccmpl {
     }
 
     virtual Element* clone() const {
-      Contours* res = new Contours(args, fontsize, fill);
+      Contours* res = new Contours(args, fontsize, fill, mode);
       res->z        = z;
       res->xmin     = xmin;
       res->xmax     = xmax;
@@ -1114,7 +2665,10 @@ namespace ccmpl {
     }
       
     virtual void plot_getdata(std::ostream& os) {
-      python::get_contours(os,suffix, args, fontsize);
+      if(mode == extraction::cpp)
+	python::get_contour_segments(os, suffix, args, args.find("color") == std::string::npos);
+      else
+	python::get_contours(os,suffix, args, fontsize);
     }
       
     virtual void plot(std::ostream& os) {
@@ -1124,6 +2678,19 @@ namespace ccmpl {
     virtual void _print_data(std::ostream& os) {
       os << xmin << ' ' << xmax << ' ' << nb_x << std::endl
 	 << ymin << ' ' << ymax << ' ' << nb_y << std::endl;
+      if(mode == extraction::cpp) {
+	std::vector<double> levels(ccmpl::range(zmin,zmax,nb_z).begin(), ccmpl::range(zmin,zmax,nb_z).end());
+	algo::marching_squares(z, xmin, xmax, nb_x, ymin, ymax, nb_y, levels, segments);
+	os << zmin << ' ' << zmax << ' ' << levels.size() << std::endl;
+	auto level = levels.begin();
+	for(auto& segs : segments) {
+	  os << *(level++);
+	  for(auto& s : segs)
+	    os << ' ' << s.first.x << ' ' << s.first.y << ' ' << s.second.x << ' ' << s.second.y;
+	  os << std::endl;
+	}
+	return;
+      }
       for(auto v : ccmpl::range(zmin,zmax,nb_z)) os << ' ' << v;
       os << std::endl;
       for(auto zi : z) os << ' ' << zi;
@@ -1137,6 +2704,143 @@ namespace ccmpl {
     return Contours(arglist, fontsize, f);
   }
 
+  /**
+   * With ccmpl::extraction::cpp, fontsize is ignored (no labels), and args are passed to matplotlib LineCollection. Lines are colored according to their level by the colormap, unless a color is given in args.
+   */
+  template<typename FILL>
+  Contours contours(const std::string& arglist, 
+		    unsigned int fontsize, const FILL& f,
+		    extraction mode) {
+    return Contours(arglist, fontsize, f, mode);
+  }
+
+  //////////
+  //      //
+  // ECDF //
+  //      //
+  //////////
+
+  /**
+   * This draws the empirical cumulative distribution function of samples, as a staircase line. The samples are either set by a fill function, f(std::vector<double>& samples), and sorted in parallel at each frame, or kept sorted in a stats::Ecdf that you feed in your own code. Only the points needed at the resolution of the subplot are sent (see algo::ecdf_points).
+   */
+  class Cumulative : public chart::Data {
+  public:
+
+    std::vector<double> samples;
+    std::function<void (std::vector<double>&)> fill;
+    const stats::Ecdf* source; //!< If not null, the samples are the ones of this object.
+    std::vector<Point> points;
+      
+    template<typename FILL>
+    Cumulative(const std::string& arglist, const FILL& f)
+      : chart::Data(arglist), samples(), fill(f), source(nullptr), points() {}
+    Cumulative(const std::string& arglist, const stats::Ecdf& source)
+      : chart::Data(arglist), samples(), fill(), source(&source), points() {}
+    virtual ~Cumulative() {}
+      
+    virtual chart::Element* clone() const {
+      Cumulative* res = source ? new Cumulative(args, *source) : new Cumulative(args, fill);
+      res->samples = samples;
+      return res;
+    }
+
+    virtual void refill() {
+      if(source) return;
+      fill(samples);
+      algo::parallel_sort(samples.begin(), samples.end());
+    }
+			    
+    virtual void _print_data(std::ostream& os) {
+      algo::ecdf_points(source ? source->values : samples,
+			viewport.width  == 0 ? 1024 : viewport.width,
+			viewport.height == 0 ? 1024 : viewport.height,
+			points);
+      internal::print_line(os, points);
+    }
+
+    virtual void plot_getdata(std::ostream& os) {
+      python::get_line(os,suffix);
+    }
+
+    virtual void plot(std::ostream& os) {
+      python::plot_line(os,suffix,args);
+    }
+  };
+
+  /**
+   * The args are the ones of matplotlib plot.
+   */
+  template<typename FILL>
+  Cumulative ecdf(const std::string& arglist, const FILL& f) {
+    return Cumulative(arglist, f);
+  }
+
+  /**
+   * The samples are the ones of the stats::Ecdf, which has to live as long as the display.
+   */
+  inline Cumulative ecdf(const std::string& arglist, const stats::Ecdf& source) {
+    return Cumulative(arglist, source);
+  }
+
+  /////////
+  //     //
+  // KDE //
+  //     //
+  /////////
+
+  /**
+   * This displays, as a line, the Gaussian kernel density estimation of the samples set by f(std::vector<double>& samples). It is computed in C++ (see algo::kde1d) on nb points spanning the samples (for heavy-tailed samples, their central 99% on up to 4*nb points, see algo::kde_grid), with the bandwidth h, or with the bandwidth given by algo::silverman_bandwidth if h is 0. The args are the ones of ccmpl::line.
+   */
+  template<typename FILL>
+  Line kde1d(const std::string& arglist, const FILL& f, unsigned int nb = 512, double h = 0) {
+    std::vector<double> samples, density;
+    return Line(arglist,
+		[f, nb, h, samples, density](std::vector<Point>& points) mutable {
+		  f(samples);
+		  points.clear();
+		  if(samples.size() == 0) return;
+		  double bw = h > 0 ? h : algo::silverman_bandwidth(samples.begin(), samples.end(), [](double v) {return v;});
+		  double xmin, xmax;
+		  unsigned int nb_x;
+		  algo::kde_grid(samples, bw, nb, 4*nb, xmin, xmax, nb_x);
+		  algo::kde1d(samples.begin(), samples.end(), [](double v) {return v;}, bw, xmin, xmax, nb_x, density);
+		  unsigned int i = 0;
+		  for(auto x : ccmpl::range(xmin, xmax, nb_x)) points.push_back({x, density[i++]});
+		});
+  }
+
+  /**
+   * This displays, as nb_levels isolines, the Gaussian kernel density estimation of the points set by f(std::vector<ccmpl::Point>& points). It is computed in C++ (see algo::kde2d) on a nb*nb grid spanning the points (or their central 99% on a finer grid, up to 4*nb per axis, for heavy tails, see algo::kde_grid), with the bandwidths given by algo::silverman_bandwidth. The levels are regularly spread between 0 and the maximal density, both excluded. The args are the ones of ccmpl::contours.
+   */
+  template<typename FILL>
+  Contours kde2d(const std::string& arglist, const FILL& f, unsigned int nb_levels = 8, unsigned int nb = 128,
+		 extraction mode = extraction::cpp, unsigned int fontsize = 0) {
+    std::vector<Point> points;
+    std::vector<double> xs, ys;
+    nb_levels = std::max(nb_levels, 2u);
+    return Contours(arglist, fontsize,
+		    [f, nb_levels, nb, points, xs, ys](std::vector<double>& z,
+					       double& xmin, double& xmax, unsigned int& nb_x,
+					       double& ymin, double& ymax, unsigned int& nb_y,
+					       double& zmin, double& zmax, unsigned int& nb_z) mutable {
+		      f(points);
+		      double hx = algo::silverman_bandwidth(points.begin(), points.end(), [](const Point& p) {return p.x;}, 2);
+		      double hy = algo::silverman_bandwidth(points.begin(), points.end(), [](const Point& p) {return p.y;}, 2);
+		      xs.clear();
+		      ys.clear();
+		      for(auto& p : points) {xs.push_back(p.x); ys.push_back(p.y);}
+		      algo::kde_grid(xs, hx, nb, 4*nb, xmin, xmax, nb_x);
+		      algo::kde_grid(ys, hy, nb, 4*nb, ymin, ymax, nb_y);
+		      algo::kde2d(points.begin(), points.end(), hx, hy, xmin, xmax, nb_x, ymin, ymax, nb_y, z);
+		      double top = z.size() == 0 ? 0 : *std::max_element(z.begin(), z.end());
+		      if(!(top > 0)) top = 1;
+		      zmin = top/(nb_levels + 1);
+		      zmax = top*nb_levels/(nb_levels + 1);
+		      nb_z = nb_levels;
+		    },
+		    mode);
+  }
+
   /////////////
   //         //
   // Text    //
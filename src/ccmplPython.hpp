@@ -30,6 +30,7 @@
 #include <iostream>
 #include <list>
 #include <stdexcept>
+#include <sstream>
 #include <ccmplTypes.hpp>
 #include <ccmplUtility.hpp>
 
@@ -142,7 +143,19 @@ namespace ccmpl {
 	plot_list(height_ratios, os);
       }
 
-      os << ")" << std::endl;
+      // Limits set by the viewer itself (to fit an image for example)
+      // are recorded by set_lims, so that the feedback only reports the
+      // ones fixed by ccmpl::view2d or by a zoom/pan in the GUI.
+      os << ")" << std::endl
+	 << "feedback_axes = []" << std::endl
+	 << "def set_lims(ax, xlim, ylim):" << std::endl
+	 << "\tax.set_xlim(xlim)" << std::endl
+	 << "\tax.set_ylim(ylim)" << std::endl
+	 << "\tax.viewer_lims = (tuple(ax.get_xlim()), tuple(ax.get_ylim()))" << std::endl
+	 << "def user_lims(ax):" << std::endl
+	 << "\tlims = getattr(ax, 'viewer_lims', (None, None))" << std::endl
+	 << "\treturn (not ax.get_autoscalex_on() and tuple(ax.get_xlim()) != lims[0]," << std::endl
+	 << "\t        not ax.get_autoscaley_on() and tuple(ax.get_ylim()) != lims[1])" << std::endl;
       os << std::endl;
     }
       
@@ -172,7 +185,15 @@ namespace ccmpl {
 	 << "\tfig.canvas.draw()" << std::endl;
       if(movie)
 	os << "\twriter.grab_frame()" << std::endl;
-      os << "\tconnection.send(b'!') # send acknowledgment back." << std::endl
+      // The acknowledgment tells the current view of each axes, and
+      // whether its x and y limits are free (i.e. not fixed by the user).
+      os << "\tfeedback = ['!']" << std::endl
+	 << "\tfor a in feedback_axes :" << std::endl
+	 << "\t\tbbox = a.get_window_extent()" << std::endl
+	 << "\t\tfixed_x, fixed_y = user_lims(a)" << std::endl
+	 << "\t\tfeedback += [repr(float(v)) for v in tuple(a.get_xlim()) + tuple(a.get_ylim())]" << std::endl
+	 << "\t\tfeedback += [str(int(bbox.width)), str(int(bbox.height)), str(int(not fixed_x)), str(int(not fixed_y))]" << std::endl
+	 << "\tconnection.sendall((' '.join(feedback) + '\\n').encode()) # send acknowledgment back." << std::endl
 	 << "\tcont = pipe.readline().split()[0]=='cont'" << std::endl;
     }
       
@@ -209,7 +230,8 @@ namespace ccmpl {
       if(is_3d)
 	os << ", projection='3d'";
       os << ")" << std::endl
-	 << "plt.sca(ax)" << std::endl;
+	 << "plt.sca(ax)" << std::endl
+	 << "feedback_axes.append(ax)" << std::endl;
 
       if(is_3d)
 	p3d(os, "ax");
@@ -264,15 +286,42 @@ namespace ccmpl {
 	 << "between" << suffix << " = None" << std::endl;
     }
       
-    inline void get_between(std::ostream& os, 
-			    const std::string& suffix,
-			    const std::string& args) {
-      start_data(os);
+    inline void read_between(std::ostream& os, 
+			     const std::string& suffix,
+			     const std::string& args) {
       os << "\t\tx  = [float(v) for v in pipe.readline().split()]" << std::endl
 	 << "\t\ty1 = [float(v) for v in pipe.readline().split()]" << std::endl
 	 << "\t\ty2 = [float(v) for v in pipe.readline().split()]" << std::endl
 	 << "\t\tif between" << suffix << " != None : between" << suffix << ".remove()" << std::endl
 	 << "\t\tbetween" << suffix << " = ax" << suffix << ".fill_between(x,y1,y2" << add_args(args) << ")" << std::endl;
+    }
+      
+    inline void get_between(std::ostream& os, 
+			    const std::string& suffix,
+			    const std::string& args) {
+      start_data(os);
+      read_between(os, suffix, args);
+      end_data(os);
+    }
+
+    // This is a between area, with an optional line.
+    inline void plot_band(std::ostream& os,
+			  const std::string& suffix,
+			  bool with_line,
+			  const std::string& line_args) {
+      plot_between(os, suffix);
+      if(with_line)
+	os << "band" << suffix << ", = plt.plot([], []" << add_args(line_args) << ")" << std::endl;
+    }
+      
+    inline void get_band(std::ostream& os, 
+			 const std::string& suffix,
+			 const std::string& args,
+			 bool with_line) {
+      start_data(os);
+      read_between(os, suffix, args);
+      if(with_line)
+	os << "\t\tband" << suffix << ".set_data(x, [float(v) for v in pipe.readline().split()])" << std::endl;
       end_data(os);
     }
       
@@ -337,6 +386,226 @@ namespace ccmpl {
       end_data(os);
     }
       
+    // This reads x0, dx and n, and rebuilds the abscissas x<suffix>
+    // only when they have changed since the previous frame.
+    inline void read_sampling(std::ostream& os, const std::string& suffix) {
+      os << "\t\tsampling = pipe.readline().split()" << std::endl
+	 << "\t\tsampling = (float(sampling[0]), float(sampling[1]), int(sampling[2]))" << std::endl
+	 << "\t\tif sampling != sampling" << suffix << " :" << std::endl
+	 << "\t\t\tsampling" << suffix << " = sampling" << std::endl
+	 << "\t\t\tx" << suffix << " = sampling[0] + sampling[1]*np.arange(sampling[2])" << std::endl;
+    }
+
+    inline void plot_signal(std::ostream& os,
+			    const std::string& suffix,
+			    const std::string& args) {
+      os << "signal" << suffix << ", = plt.plot([], []" << add_args(args) << ")" << std::endl
+	 << "sampling" << suffix << " = None" << std::endl;
+    }
+      
+    inline void get_signal(std::ostream& os, const std::string& suffix) {
+      start_data(os);
+      read_sampling(os, suffix);
+      os << "\t\ty = np.array([float(v) for v in pipe.readline().split()])" << std::endl
+	 << "\t\tsignal" << suffix << ".set_data(x" << suffix << ",y)" << std::endl;
+      end_data(os);
+    }
+      
+    inline void plot_signals(std::ostream& os,
+			     const std::string& suffix) {
+      os << "ax" << suffix << " = ax" << std::endl
+	 << "signals" << suffix << " = []" << std::endl
+	 << "sampling" << suffix << " = None" << std::endl;
+    }
+
+    // The curves are only created again when their number changes.
+    inline void get_signals(std::ostream& os,
+			    const std::string& suffix,
+			    const std::string& args) {
+      start_data(os);
+      os << "\t\tnb_lines = int(pipe.readline())" << std::endl;
+      read_sampling(os, suffix);
+      os << "\t\tif len(signals" << suffix << ") != nb_lines :" << std::endl
+	 << "\t\t\tfor line in signals" << suffix << " : line.remove()" << std::endl
+	 << "\t\t\tsignals" << suffix << " = [ax" << suffix << ".plot([], []" << add_args(args) << ")[0] for l in range(nb_lines)]" << std::endl
+	 << "\t\tfor line in signals" << suffix << " :" << std::endl
+	 << "\t\t\tline.set_data(x" << suffix << ", np.array([float(v) for v in pipe.readline().split()]))" << std::endl;
+      end_data(os);
+    }
+
+    inline void plot_signal_between(std::ostream& os,
+				    const std::string& suffix) {
+      os << "ax" << suffix << " = ax" << std::endl
+	 << "between" << suffix << " = None" << std::endl
+	 << "sampling" << suffix << " = None" << std::endl;
+    }
+      
+    inline void get_signal_between(std::ostream& os, 
+				   const std::string& suffix,
+				   const std::string& args) {
+      start_data(os);
+      read_sampling(os, suffix);
+      os << "\t\ty1 = np.array([float(v) for v in pipe.readline().split()])" << std::endl
+	 << "\t\ty2 = np.array([float(v) for v in pipe.readline().split()])" << std::endl
+	 << "\t\tif between" << suffix << " != None : between" << suffix << ".remove()" << std::endl
+	 << "\t\tbetween" << suffix << " = ax" << suffix << ".fill_between(x" << suffix << ",y1,y2" << add_args(args) << ")" << std::endl;
+      end_data(os);
+    }
+      
+    inline void plot_strip(std::ostream& os,
+			   const std::string& suffix,
+			   const std::string& args) {
+      os << "strip" << suffix << ", = plt.plot([], []" << add_args(args) << ")" << std::endl
+	 << "strip_t" << suffix << " = None" << std::endl;
+    }
+
+    // The ring buffer is stored twice in arrays of 2*capacity values, so
+    // that the samples, from the oldest one, are always a contiguous
+    // slice. The line is given views on it, nothing is copied. The
+    // buffer is emptied when the C++ side has been cleared.
+    inline void get_strip(std::ostream& os, const std::string& suffix) {
+      start_data(os);
+      os << "\t\tcapacity, reset = [int(v) for v in pipe.readline().split()]" << std::endl
+	 << "\t\tt = np.array([float(v) for v in pipe.readline().split()])" << std::endl
+	 << "\t\ty = np.array([float(v) for v in pipe.readline().split()])" << std::endl
+	 << "\t\tif strip_t" << suffix << " is None or len(strip_t" << suffix << ") != 2*capacity or reset :" << std::endl
+	 << "\t\t\tstrip_t" << suffix << " = np.zeros(2*capacity)" << std::endl
+	 << "\t\t\tstrip_y" << suffix << " = np.zeros(2*capacity)" << std::endl
+	 << "\t\t\tstrip_head" << suffix << " = 0" << std::endl
+	 << "\t\t\tstrip_count" << suffix << " = 0" << std::endl
+	 << "\t\tidx = (strip_head" << suffix << " + np.arange(len(t))) % capacity" << std::endl
+	 << "\t\tstrip_t" << suffix << "[idx] = t" << std::endl
+	 << "\t\tstrip_t" << suffix << "[idx + capacity] = t" << std::endl
+	 << "\t\tstrip_y" << suffix << "[idx] = y" << std::endl
+	 << "\t\tstrip_y" << suffix << "[idx + capacity] = y" << std::endl
+	 << "\t\tstrip_head" << suffix << " = (strip_head" << suffix << " + len(t)) % capacity" << std::endl
+	 << "\t\tstrip_count" << suffix << " = min(strip_count" << suffix << " + len(t), capacity)" << std::endl
+	 << "\t\tstart = (strip_head" << suffix << " - strip_count" << suffix << ") % capacity" << std::endl
+	 << "\t\tstrip" << suffix << ".set_data(strip_t" << suffix << "[start:start + strip_count" << suffix << "], strip_y" << suffix << "[start:start + strip_count" << suffix << "])" << std::endl;
+      end_data(os);
+    }
+      
+    inline void plot_accumulation(std::ostream& os,
+				  const std::string& suffix) {
+      os << "ax" << suffix << " = ax" << std::endl
+	 << "accum" << suffix << " = None" << std::endl
+	 << "accum_xy" << suffix << " = np.empty((1024, 2))" << std::endl
+	 << "accum_n" << suffix << " = 0" << std::endl;
+    }
+
+    // The offsets are stored in an array whose size is doubled when
+    // it is full, and a single collection is updated. A reset empties
+    // the array, and the data limits are recomputed from the new points.
+    inline void get_accumulation(std::ostream& os,
+				 const std::string& suffix,
+				 const std::string& args) {
+      start_data(os);
+      os << "\t\tif int(pipe.readline()) :" << std::endl
+	 << "\t\t\taccum_n" << suffix << " = 0" << std::endl
+	 << "\t\t\tax" << suffix << ".ignore_existing_data_limits = True" << std::endl
+	 << "\t\tx = np.array([float(v) for v in pipe.readline().split()])" << std::endl
+	 << "\t\ty = np.array([float(v) for v in pipe.readline().split()])" << std::endl
+	 << "\t\tidx = np.array([int(v) for v in pipe.readline().split()], dtype=int)" << std::endl
+	 << "\t\trx = np.array([float(v) for v in pipe.readline().split()])" << std::endl
+	 << "\t\try = np.array([float(v) for v in pipe.readline().split()])" << std::endl
+	 << "\t\tn = accum_n" << suffix << " + len(x)" << std::endl
+	 << "\t\tif n > len(accum_xy" << suffix << ") :" << std::endl
+	 << "\t\t\tgrown = np.empty((max(2*len(accum_xy" << suffix << "), n), 2))" << std::endl
+	 << "\t\t\tgrown[:accum_n" << suffix << "] = accum_xy" << suffix << "[:accum_n" << suffix << "]" << std::endl
+	 << "\t\t\taccum_xy" << suffix << " = grown" << std::endl
+	 << "\t\taccum_xy" << suffix << "[accum_n" << suffix << ":n, 0] = x" << std::endl
+	 << "\t\taccum_xy" << suffix << "[accum_n" << suffix << ":n, 1] = y" << std::endl
+	 << "\t\taccum_xy" << suffix << "[idx, 0] = rx" << std::endl
+	 << "\t\taccum_xy" << suffix << "[idx, 1] = ry" << std::endl
+	 << "\t\taccum_n" << suffix << " = n" << std::endl
+	 << "\t\tif accum" << suffix << " is None :" << std::endl
+	 << "\t\t\taccum" << suffix << " = ax" << suffix << ".scatter(accum_xy" << suffix << "[:n, 0], accum_xy" << suffix << "[:n, 1]" << add_args(args) << ")" << std::endl
+	 << "\t\telse :" << std::endl
+	 << "\t\t\taccum" << suffix << ".set_offsets(accum_xy" << suffix << "[:n])" << std::endl
+	 << "\t\tif len(x) + len(rx) > 0 :" << std::endl
+	 << "\t\t\tax" << suffix << ".update_datalim(np.column_stack((np.concatenate((x, rx)), np.concatenate((y, ry)))))" << std::endl
+	 << "\t\t\tax" << suffix << ".autoscale_view()" << std::endl;
+      end_data(os);
+    }
+      
+    inline void plot_waterfall(std::ostream& os,
+			       const std::string& suffix) {
+      os << "ax" << suffix << " = ax" << std::endl
+	 << "waterfall" << suffix << " = None" << std::endl;
+    }
+
+    // The rows are scrolled in place in the image array, the newest
+    // ones being appended at the top.
+    inline void get_waterfall(std::ostream& os,
+			      const std::string& suffix,
+			      const std::string& args) {
+      start_data(os);
+      os << "\t\tnb_rows, width, xmin, xmax = [float(v) for v in pipe.readline().split()]" << std::endl
+	 << "\t\tnb_rows, width = int(nb_rows), int(width)" << std::endl
+	 << "\t\tk, reset = [int(v) for v in pipe.readline().split()]" << std::endl
+	 << "\t\trows = np.array([float(v) for v in pipe.readline().split()]).reshape((k, width))" << std::endl
+	 << "\t\tif waterfall" << suffix << " == None or waterfall_Z" << suffix << ".shape != (nb_rows, width) :" << std::endl
+	 << "\t\t\tif waterfall" << suffix << " != None : waterfall" << suffix << ".remove()" << std::endl
+	 << "\t\t\twaterfall_Z" << suffix << " = np.full((nb_rows, width), np.nan)" << std::endl
+	 << "\t\t\twaterfall" << suffix << " = ax" << suffix << ".imshow(waterfall_Z" << suffix << ", origin='lower', extent=(xmin, xmax, -nb_rows, 0), aspect='auto'" << add_args(args) << ")" << std::endl
+	 << "\t\tif reset :" << std::endl
+	 << "\t\t\twaterfall_Z" << suffix << "[:] = np.nan" << std::endl
+	 << "\t\tif k > 0 :" << std::endl
+	 << "\t\t\twaterfall_Z" << suffix << "[:nb_rows - k] = waterfall_Z" << suffix << "[k:]" << std::endl
+	 << "\t\t\twaterfall_Z" << suffix << "[nb_rows - k:] = rows" << std::endl
+	 << "\t\tif k > 0 or reset :" << std::endl
+	 << "\t\t\twaterfall" << suffix << ".set_data(waterfall_Z" << suffix << ")" << std::endl;
+      if(args.find("vmin") == std::string::npos && args.find("vmax") == std::string::npos)
+	os << "\t\t\tif np.isfinite(waterfall_Z" << suffix << ").any() : waterfall" << suffix << ".set_clim(np.nanmin(waterfall_Z" << suffix << "), np.nanmax(waterfall_Z" << suffix << "))" << std::endl;
+      end_data(os);
+    }
+      
+    inline void plot_distributions(std::ostream& os,
+				   const std::string& suffix) {
+      os << "ax" << suffix << " = ax" << std::endl
+	 << "distributions" << suffix << " = []" << std::endl;
+    }
+
+    inline void start_distributions(std::ostream& os, const std::string& suffix) {
+      os << "\t\tfor a in distributions" << suffix << " : a.remove()" << std::endl
+	 << "\t\tdistributions" << suffix << " = []" << std::endl
+	 << "\t\tnb = int(pipe.readline())" << std::endl
+	 << "\t\tpositions = []" << std::endl
+	 << "\t\tsummaries = []" << std::endl;
+    }
+    
+    inline void get_boxes(std::ostream& os,
+			  const std::string& suffix,
+			  const std::string& args) {
+      start_data(os);
+      start_distributions(os, suffix);
+      os << "\t\tfor i in range(nb) :" << std::endl
+	 << "\t\t\tv = [float(v) for v in pipe.readline().split()]" << std::endl
+	 << "\t\t\tpositions.append(v[0])" << std::endl
+	 << "\t\t\tsummaries.append({'whislo' : v[1], 'q1' : v[2], 'med' : v[3], 'q3' : v[4], 'whishi' : v[5], 'mean' : v[6], 'fliers' : []})" << std::endl
+	 << "\t\tif nb > 0 :" << std::endl
+	 << "\t\t\tfor artists in ax" << suffix << ".bxp(summaries, positions=positions" << add_args(args) << ").values() : distributions" << suffix << " += artists" << std::endl;
+      end_data(os);
+    }
+    
+    inline void get_violins(std::ostream& os,
+			    const std::string& suffix,
+			    const std::string& args) {
+      start_data(os);
+      start_distributions(os, suffix);
+      os << "\t\tfor i in range(nb) :" << std::endl
+	 << "\t\t\tv = [float(v) for v in pipe.readline().split()]" << std::endl
+	 << "\t\t\tcoords = np.array([float(v) for v in pipe.readline().split()])" << std::endl
+	 << "\t\t\tvals = np.array([float(v) for v in pipe.readline().split()])" << std::endl
+	 << "\t\t\tpositions.append(v[0])" << std::endl
+	 << "\t\t\tsummaries.append({'coords' : coords, 'vals' : vals, 'min' : v[1], 'max' : v[2], 'median' : v[3], 'mean' : v[4]})" << std::endl
+	 << "\t\tif nb > 0 :" << std::endl
+	 << "\t\t\tfor artists in ax" << suffix << ".violin(summaries, positions=positions" << add_args(args) << ").values() :" << std::endl
+	 << "\t\t\t\tif isinstance(artists, list) : distributions" << suffix << " += artists" << std::endl
+	 << "\t\t\t\telse : distributions" << suffix << ".append(artists)" << std::endl;
+      end_data(os);
+    }
+      
     inline void plot_dot(std::ostream& os,
 			 const std::string& suffix) {
       os << "ax" << suffix << " = ax" << std::endl
@@ -402,6 +671,71 @@ namespace ccmpl {
       end_data(os);
     }
       
+    // This reads a line of counts sent by internal::print_counts into
+    // the numpy array var, of size nb.
+    inline void read_counts(std::ostream& os, const std::string& var, const std::string& nb) {
+      os << "\t\tcounts_line = pipe.readline().split()" << std::endl
+	 << "\t\tif counts_line[0] == 'dense' :" << std::endl
+	 << "\t\t\t" << var << " = np.array([float(v) for v in counts_line[1:]])" << std::endl
+	 << "\t\telse :" << std::endl
+	 << "\t\t\t" << var << " = np.zeros(" << nb << ")" << std::endl
+	 << "\t\t\tpairs = np.array([float(v) for v in counts_line[1:]]).reshape((-1,2))" << std::endl
+	 << "\t\t\t" << var << "[pairs[:,0].astype(int)] = pairs[:,1]" << std::endl;
+    }
+    
+    // This displays the image Z over (xmin, xmax, ymin, ymax) in the
+    // variable var+suffix, created at the first frame and updated
+    // afterwards. The extra args are appended to the imshow call.
+    inline void show_image(std::ostream& os, const std::string& var,
+			   const std::string& suffix,
+			   const std::string& extra_args) {
+      os << "\t\tif " << var << suffix << " == None :" << std::endl
+	 << "\t\t\t" << var << suffix << " = ax" << suffix << ".imshow(Z, origin='lower', extent=(xmin, xmax, ymin, ymax), aspect=ax" << suffix << ".get_aspect()"
+	 << extra_args << ')' << std::endl
+	 << "\t\telse :" << std::endl
+	 << "\t\t\t" << var << suffix << ".set_data(Z)" << std::endl
+	 << "\t\t\t" << var << suffix << ".set_extent((xmin, xmax, ymin, ymax))" << std::endl;
+    }
+
+    inline void get_raster(std::ostream& os, const std::string& suffix,
+			   const std::string& args,
+			   double vmin, double vmax) {
+      start_data(os);
+      os << "\t\txmin, xmax, ymin, ymax, w, h = [float(v) for v in pipe.readline().split()]" << std::endl
+	 << "\t\tZ = np.array([float(v) for v in pipe.readline().split()]).reshape((int(h), int(w)))" << std::endl;
+      std::ostringstream bounds;
+      bounds << ", vmin=" << vmin << ", vmax=" << vmax;
+      show_image(os, "surface", suffix, bounds.str() + add_args(args));
+      end_data(os);
+    }
+
+    // This reads the number of points in each pixel of a frame. The
+    // image gets its color limits from the counts, unless they are
+    // given in the args.
+    inline void get_density(std::ostream& os, const std::string& suffix,
+			    const std::string& var,
+			    const std::string& args) {
+      start_data(os);
+      os << "\t\txmin, xmax, ymin, ymax, w, h = [float(v) for v in pipe.readline().split()]" << std::endl;
+      read_counts(os, "counts", "int(w*h)");
+      os << "\t\tZ = np.ma.masked_equal(counts.reshape((int(h), int(w))), 0)" << std::endl;
+      show_image(os, var, suffix, add_args(args));
+      if(args.find("vmin") == std::string::npos && args.find("vmax") == std::string::npos)
+	os << "\t\t" << var << suffix << ".autoscale()" << std::endl;
+      end_data(os);
+    }
+
+    // This reads the RGBA pixels of a frame sent as hexadecimal bytes.
+    inline void get_blend(std::ostream& os, const std::string& suffix,
+			  const std::string& var,
+			  const std::string& args) {
+      start_data(os);
+      os << "\t\txmin, xmax, ymin, ymax, w, h = [float(v) for v in pipe.readline().split()]" << std::endl
+	 << "\t\tZ = np.frombuffer(bytes.fromhex(pipe.readline().strip()), dtype=np.uint8).reshape((int(h), int(w), 4))" << std::endl;
+      show_image(os, var, suffix, add_args(args));
+      end_data(os);
+    }
+      
     inline void plot_palette(std::ostream& os,
 			     const std::string& suffix) {
       os << "ax" << suffix << " = ax" << std::endl
@@ -459,11 +793,10 @@ namespace ccmpl {
 			    const std::string& suffix,
 			    const std::string& args) {
       start_data(os);
-      os << "\t\tbar_width   = float(pipe.readline())" << std::endl
-	 << "\t\tbar_centers = [float(v) for v in pipe.readline().split()]" << std::endl
+      os << "\t\tbar_edges   = np.array([float(v) for v in pipe.readline().split()])" << std::endl
 	 << "\t\tbar_heights = [float(v) for v in pipe.readline().split()]" << std::endl
 	 << "\t\tif histo1d" << suffix << " != None : histo1d" << suffix << ".remove()" << std::endl
-	 << "\t\thisto1d" << suffix << " = ax" << suffix << ".bar(bar_centers, bar_heights, bar_width, align='center'" << add_args(args) << ")" << std::endl;
+	 << "\t\thisto1d" << suffix << " = ax" << suffix << ".bar(bar_edges[:-1], bar_heights, np.diff(bar_edges), align='edge'" << add_args(args) << ")" << std::endl;
       end_data(os);
       
     }
@@ -506,12 +839,23 @@ namespace ccmpl {
       os << "histo3d" << suffix << " = None" << std::endl;
     }
       
+    // When edges is true, the bin edges along x and y are read before
+    // the counts, and the bars are rebuilt from them.
     inline void get_histo3d(std::ostream& os, const std::string& suffix,
-			    const std::string& args) {
+			    const std::string& args, bool edges = false) {
       start_data(os);
       os <<"\t\tif(histo3d" << suffix << " != None):" << std::endl;
       os <<"\t\t\thisto3d" << suffix <<".remove()" << std::endl;
-      os << "\t\tdz = np.array([float(v) for v in pipe.readline().split()])" << std::endl;
+      if(edges) {
+	os << "\t\txe = np.array([float(v) for v in pipe.readline().split()])" << std::endl
+	   << "\t\tye = np.array([float(v) for v in pipe.readline().split()])" << std::endl
+	   << "\t\tx" << suffix << " = np.tile(.5*(xe[:-1] + xe[1:]), ye.size - 1)" << std::endl
+	   << "\t\ty" << suffix << " = np.repeat(.5*(ye[:-1] + ye[1:]), xe.size - 1)" << std::endl
+	   << "\t\tdx" << suffix << " = np.tile(np.diff(xe), ye.size - 1)" << std::endl
+	   << "\t\tdy" << suffix << " = np.repeat(np.diff(ye), xe.size - 1)" << std::endl;
+      }
+      read_counts(os, "dz", "x" + suffix + ".size");
+      os << "\t\tdz[dz == 0] = .01" << std::endl;
 	
       os << "\t\tax" << suffix 
 	 << ".bar3d"
@@ -561,13 +905,22 @@ namespace ccmpl {
       os << "histo2d" << suffix << " = None" << std::endl;
     }
       
+    // When edges is true, the bin edges along x and y are read before
+    // the counts, and the mesh is rebuilt from them.
     inline void get_histo2d(std::ostream& os, const std::string& suffix,
 			    const std::string& args,
-			    unsigned int nbx, unsigned int nby) {
+			    unsigned int nbx, unsigned int nby, bool edges = false) {
       start_data(os);
       os <<"\t\tif(histo2d" << suffix << " != None):" << std::endl;
       os <<"\t\t\thisto2d" << suffix <<".remove()" << std::endl;
-      os << "\t\tz = np.array([float(v) for v in pipe.readline().split()])" << std::endl;
+      if(edges) {
+	os << "\t\txe = np.array([float(v) for v in pipe.readline().split()])" << std::endl
+	   << "\t\tye = np.array([float(v) for v in pipe.readline().split()])" << std::endl
+	   << "\t\tx" << suffix << ", y" << suffix << " = np.meshgrid(xe, ye)" << std::endl;
+      }
+      read_counts(os, "counts", std::to_string(nbx*nby));
+      os << "\t\tz = np.zeros((" << nby+1 << ',' << nbx+1 << "))" << std::endl;
+      os << "\t\tz[:" << nby << ",:" << nbx << "] = counts.reshape((" << nby << ',' << nbx << "))" << std::endl;
       // os << "\t\tzsum = z.sum()" << std::endl;
       // os << "\t\tif(zsum != 0):" << std::endl;
       // os << "\t\t\tz /= zsum" << std::endl;
@@ -576,11 +929,39 @@ namespace ccmpl {
 	 << ".pcolormesh"
 	 << "(x" << suffix 
 	 << ", y" << suffix 
-	 << ", z.reshape((" << nby+1 << ',' << nbx+1 <<"))"
+	 << ", z"
 	 << add_args(args) << ')' << std::endl;
       end_data(os);
     }
       
+    inline void plot_hexbin(std::ostream& os,
+			    const std::string& suffix,
+			    const std::string& args,
+			    double xmin, double xmax, unsigned int nx,
+			    double ymin, double ymax, unsigned int ny) {
+      double sx = (xmax-xmin)/nx;
+      double sy = (ymax-ymin)/ny;
+      os << "ax" << suffix << " = ax" << std::endl
+	 << "i1, j1 = np.meshgrid(np.arange(" << nx+1 << "), np.arange(" << ny+1 << "))" << std::endl
+	 << "i2, j2 = np.meshgrid(np.arange(" << nx << ") + .5, np.arange(" << ny << ") + .5)" << std::endl
+	 << "centers = np.column_stack((" << xmin << " + " << sx << "*np.concatenate((i1.ravel(), i2.ravel())), "
+	 << ymin << " + " << sy << "*np.concatenate((j1.ravel(), j2.ravel()))))" << std::endl
+	 << "hexagon = np.array([[.5, -.5], [.5, .5], [0., 1.], [-.5, .5], [-.5, -.5], [0., -1.]])*[" << sx << ", " << sy/3 << "]" << std::endl
+	 << "hexbin" << suffix << " = mpl.collections.PolyCollection(centers[:, None, :] + hexagon[None, :, :]" << add_args(args) << ")" << std::endl
+	 << "hexbin" << suffix << ".set_array(np.ma.masked_equal(np.zeros(len(centers)), 0))" << std::endl
+	 << "ax" << suffix << ".add_collection(hexbin" << suffix << ")" << std::endl;
+    }
+      
+    // Empty cells are masked, so that they are not drawn.
+    inline void get_hexbin(std::ostream& os, const std::string& suffix,
+			   unsigned int nx, unsigned int ny) {
+      start_data(os);
+      read_counts(os, "counts", std::to_string((nx+1)*(ny+1) + nx*ny));
+      os << "\t\thexbin" << suffix << ".set_array(np.ma.masked_equal(counts, 0))" << std::endl
+	 << "\t\thexbin" << suffix << ".autoscale()" << std::endl;
+      end_data(os);
+    }
+      
     inline void plot_vectors(std::ostream& os,
 			     const std::string& suffix) {
       os << "ax" << suffix << " = ax" << std::endl
@@ -655,20 +1036,38 @@ namespace ccmpl {
       os << "axim" << suffix << ".set_data([0,1],[0,1],np.array([0,0,0,0]).reshape((2,2,1))) # fake image" << std::endl;
       os << "axim" << suffix << ".set_extent((0,1,0,1))" << std::endl;
       os << "ax.images.append(axim" << suffix << ")" << std::endl;
+      os << "imlim" << suffix << " = None" << std::endl;
     }
 
+    // If limits_once is true, the axes limits are only set from the
+    // first image, the next ones may be cropped to the view.
     inline void get_image(std::ostream& os,
-			  const std::string& suffix) {
+			  const std::string& suffix,
+			  bool limits_once = false) {
       start_data(os);
-      os << "\t\tx = np.array([float(v) for v in pipe.readline().split()])" << std::endl;
-      os << "\t\ty = np.array([float(v) for v in pipe.readline().split()])" << std::endl;
-      os << "\t\trawz = [float(v) for v in pipe.readline().split()]" << std::endl;
-      os << "\t\twidth, depth = [int(v) for v in pipe.readline().split()]" << std::endl;
-      os << "\t\tim = np.array(rawz).reshape((len(rawz)//(width*depth), width, depth))" << std::endl;
-      os << "\t\taxim" << suffix << ".set_data(x, y, im)" << std::endl;
-      os << "\t\taxim" << suffix << ".set_extent((x.min(), x.max(), y.min(), y.max()))" << std::endl;
-      os << "\t\tax"   << suffix << ".set_xlim((x.min(), x.max()))" << std::endl;
-      os << "\t\tax"   << suffix << ".set_ylim((y.min(), y.max()))" << std::endl;
+      os << "\t\tupdate = pipe.readline().split()" << std::endl;
+      os << "\t\tif update[0] == 'full':" << std::endl;
+      os << "\t\t\timx" << suffix << " = np.array([float(v) for v in pipe.readline().split()])" << std::endl;
+      os << "\t\t\timy" << suffix << " = np.array([float(v) for v in pipe.readline().split()])" << std::endl;
+      os << "\t\t\trawz = [float(v) for v in pipe.readline().split()]" << std::endl;
+      os << "\t\t\twidth, depth = [int(v) for v in pipe.readline().split()]" << std::endl;
+      os << "\t\t\tim" << suffix << " = np.array(rawz).reshape((len(rawz)//(width*depth), width, depth))" << std::endl;
+      os << "\t\t\tx, y = imx" << suffix << ", imy" << suffix << std::endl;
+      os << "\t\t\taxim" << suffix << ".set_data(x, y, im" << suffix << ")" << std::endl;
+      os << "\t\t\taxim" << suffix << ".set_extent((x.min(), x.max(), y.min(), y.max()))" << std::endl;
+      std::string indent = "\t\t\t";
+      if(limits_once) {
+	os << "\t\t\tif imlim" << suffix << " == None :" << std::endl
+	   << "\t\t\t\timlim" << suffix << " = (x.min(), x.max(), y.min(), y.max())" << std::endl;
+	indent += '\t';
+      }
+      os << indent << "set_lims(ax" << suffix << ", (x.min(), x.max()), (y.min(), y.max()))" << std::endl;
+      os << "\t\telse:" << std::endl;
+      os << "\t\t\tfor t in range(int(update[1])):" << std::endl;
+      os << "\t\t\t\ttile = pipe.readline().split()" << std::endl;
+      os << "\t\t\t\tr, c, h, w = [int(v) for v in tile[:4]]" << std::endl;
+      os << "\t\t\t\tim" << suffix << "[r:r+h, c:c+w, :] = np.array([float(v) for v in tile[4:]]).reshape((h, w, im" << suffix << ".shape[2]))" << std::endl;
+      os << "\t\t\taxim" << suffix << ".set_data(imx" << suffix << ", imy" << suffix << ", im" << suffix << ")" << std::endl;
       end_data(os);
     }
     
@@ -693,8 +1092,7 @@ namespace ccmpl {
       os << "\t\ty    = np.arange(ymin, ymax+.5*step,step)" << std::endl;
       os << "\t\tX, Y = np.meshgrid(x, y)" << std::endl;
       os << "\t\tZ = np.array([float(v) for v in pipe.readline().split()]).reshape(int(nb_y),int(nb_x))" << std::endl;
-      os << "\t\tax" << suffix << ".set_xlim((xmin,xmax))" << std::endl;
-      os << "\t\tax" << suffix << ".set_ylim((ymin,ymax))" << std::endl;
+      os << "\t\tset_lims(ax" << suffix << ", (xmin,xmax), (ymin,ymax))" << std::endl;
       os << "\t\tif contours" << suffix << " != None : " << std::endl;
       os << "\t\t\tfor d in contours" << suffix << ".collections :" << std::endl;
       os << "\t\t\t\td.remove()" << std::endl;
@@ -706,6 +1104,32 @@ namespace ccmpl {
 
     
 
+    inline void get_contour_segments(std::ostream& os,
+				     const std::string& suffix, 
+				     const std::string& args,
+				     bool colormapped) {
+      start_data(os);
+      os << "\t\t(xmin,xmax,nb_x) = [float(v) for v in pipe.readline().split()]" << std::endl;
+      os << "\t\t(ymin,ymax,nb_y) = [float(v) for v in pipe.readline().split()]" << std::endl;
+      os << "\t\t(zmin,zmax,nb_z) = [float(v) for v in pipe.readline().split()]" << std::endl;
+      os << "\t\tset_lims(ax" << suffix << ", (xmin,xmax), (ymin,ymax))" << std::endl;
+      os << "\t\tif contours" << suffix << " == None : contours" << suffix << " = []" << std::endl;
+      os << "\t\twhile len(contours" << suffix << ") > int(nb_z) : contours" << suffix << ".pop().remove()" << std::endl;
+      os << "\t\tfor l in range(int(nb_z)) :" << std::endl;
+      os << "\t\t\tvals  = np.array([float(v) for v in pipe.readline().split()])" << std::endl;
+      os << "\t\t\tsegs  = vals[1:].reshape((-1,2,2))" << std::endl;
+      os << "\t\t\tif l == len(contours" << suffix << ") :" << std::endl;
+      os << "\t\t\t\tcontours" << suffix << ".append(mpl.collections.LineCollection(segs" << add_args(args) << "))" << std::endl;
+      os << "\t\t\t\tax" << suffix << ".add_collection(contours" << suffix << "[l])" << std::endl;
+      os << "\t\t\telse :" << std::endl;
+      os << "\t\t\t\tcontours" << suffix << "[l].set_segments(segs)" << std::endl;
+      if(colormapped) {
+	os << "\t\t\tcontours" << suffix << "[l].set_array(np.full(len(segs), vals[0]))" << std::endl;
+	os << "\t\t\tcontours" << suffix << "[l].set_clim(zmin, zmax)" << std::endl;
+      }
+      end_data(os);
+    }
+
     inline void plot_text(std::ostream& os,
 			  const std::string& suffix,
 			  const std::string& args) {
@@ -0,0 +1,834 @@
+/*   This file is part of ccmpl
+ *
+ *   Copyright (C) 2015,  CentraleSupelec
+ *
+ *   Author : Herve Frezza-Buet
+ *
+ *   Contributor :
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU General Public
+ *   License (GPL) as published by the Free Software Foundation; either
+ *   version 3 of the License, or any later version.
+ *   
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *   General Public License for more details.
+ *   
+ *   You should have received a copy of the GNU General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ *   Contact : Herve.Frezza-Buet@centralesupelec.fr
+ *
+ */
+
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <iterator>
+#include <cmath>
+#include <random>
+#include <complex>
+#include <stdexcept>
+
+#include <ccmplTypes.hpp>
+#include <ccmplAlgo.hpp>
+#include <ccmplUtility.hpp>
+
+namespace ccmpl {
+
+  namespace internal {
+
+    inline bool finite(const Point& p) {return std::isfinite(p.x) && std::isfinite(p.y);}
+
+    /**
+     * This extends [min,max[, split in nb bins, so that it contains [lo,hi]. The width is doubled as many times as needed, merge(towards_max) being called at each doubling so that the counts follow. The first call sets the range to [lo,hi] (slightly enlarged).
+     */
+    template<typename MERGE>
+    void cover(double& min, double& max, unsigned int nb, bool& empty,
+	       double lo, double hi, const MERGE& merge) {
+      if(!std::isfinite(lo) || !std::isfinite(hi) || lo > hi)
+	return;
+      if(empty) {
+	double width = hi - lo;
+	if(width <= 0) width = 1e-3*std::max(std::abs(lo), 1.);
+	min   = lo;
+	max   = lo + width*nb/(nb - 1.);
+	empty = false;
+	return;
+      }
+      while(lo < min) {
+	min = max - 2*(max - min);
+	merge(false);
+      }
+      while(hi >= max) {
+	max = min + 2*(max - min);
+	merge(true);
+      }
+    }
+  }
+
+  /**
+   * This namespace gathers accumulators that summarize streams of samples in bounded memory. Elements only send the summaries.
+   */
+  namespace stats {
+
+    /**
+     * These are bin counts which can forget the past. With a decay, counts are multiplied by the decay factor at each frame. With a window, only the samples added during the last frames are counted.
+     */
+    class Bins {
+    protected:
+      
+      std::vector<std::vector<double>> blocks; // per-frame counts, when windowed.
+      unsigned int current;
+      double decay;
+
+      void count(unsigned int bin, double weight) {
+	counts[bin] += weight;
+	if(blocks.size() != 0) blocks[current][bin] += weight;
+      }
+
+      // This merges the bins pairwise along x (or y), for counts stored
+      // as nby rows of nbx bins, when the range is doubled towards its
+      // max (or its min). The freed bins are emptied.
+      void merge(unsigned int nbx, unsigned int nby, bool along_x, bool towards_max) {
+	auto merge_bins = [nbx, nby, along_x, towards_max](std::vector<double>& c) {
+	  unsigned int nb   = along_x ? nbx : nby;
+	  unsigned int half = nb/2;
+	  unsigned int nb_lines = along_x ? nby : nbx;
+	  unsigned int step     = along_x ? 1 : nbx;  // between bins along the merged axis.
+	  unsigned int stride   = along_x ? nbx : 1;  // between lines.
+	  for(unsigned int l = 0; l < nb_lines; ++l) {
+	    double* line = c.data() + l*stride;
+	    if(towards_max) {
+	      for(unsigned int i = 0; i < half; ++i)
+		line[i*step] = line[(2*i)*step] + line[(2*i+1)*step];
+	      for(unsigned int i = half; i < nb; ++i)
+		line[i*step] = 0;
+	    }
+	    else {
+	      for(unsigned int i = nb; i-- > half;)
+		line[i*step] = line[(2*i-nb)*step] + line[(2*i-nb+1)*step];
+	      for(unsigned int i = 0; i < half; ++i)
+		line[i*step] = 0;
+	    }
+	  }
+	};
+	merge_bins(counts);
+	for(auto& b : blocks) merge_bins(b);
+      }
+
+      template<typename IT, typename INDEX>
+      void count(IT begin, IT end, const INDEX& index) {
+	std::vector<unsigned long> hits(counts.size(), 0);
+	algo::histogram(begin, end, counts.size(), index, hits);
+	auto h = hits.begin();
+	for(auto& c : counts) c += *(h++);
+	if(blocks.size() != 0) {
+	  h = hits.begin();
+	  for(auto& c : blocks[current]) c += *(h++);
+	}
+      }
+      
+    public:
+
+      std::vector<double> counts;
+
+      Bins(unsigned int nb_bins) : blocks(), current(0), decay(1), counts(nb_bins, 0) {}
+      Bins(const Bins&)            = default;
+      Bins& operator=(const Bins&) = default;
+
+      /**
+       * At each frame, counts are multiplied by factor (1 means no decay).
+       */
+      void set_decay(double factor) {
+	decay = factor;
+      }
+
+      /**
+       * Only the samples added during the last nb_frames frames are counted (0 means no window). This resets the counts.
+       */
+      void set_window(unsigned int nb_frames) {
+	blocks.assign(nb_frames, std::vector<double>(counts.size(), 0));
+	current = 0;
+	reset();
+      }
+
+      void reset() {
+	std::fill(counts.begin(), counts.end(), 0);
+	for(auto& b : blocks) std::fill(b.begin(), b.end(), 0);
+      }
+
+      /**
+       * This is called by the elements once the counts have been sent.
+       */
+      void next_frame() {
+	if(blocks.size() != 0) {
+	  current = (current + 1) % blocks.size();
+	  auto& oldest = blocks[current];
+	  auto c = counts.begin();
+	  for(auto& o : oldest) {*(c++) -= o; o = 0;}
+	}
+	if(decay != 1) {
+	  for(auto& c : counts) c *= decay;
+	  for(auto& b : blocks) for(auto& c : b) c *= decay;
+	}
+      }
+    };
+
+    /**
+     * This counts the samples in nb bins regularly spread over [min,max[. Samples are not kept.
+     *
+     * If no range is given, the range adapts to the samples: it is doubled, merging the bins pairwise, each time a sample falls out of it. The number of bins is then made even. Non finite samples are not counted, and do not change the range.
+     */
+    class Histogram1d : public Bins {
+    public:
+      double min, max;
+      unsigned int nb;
+      bool autorange;
+      bool empty;
+
+      Histogram1d(double min, double max, unsigned int nb_bins) : Bins(nb_bins), min(min), max(max), nb(nb_bins), autorange(false), empty(false) {}
+      explicit Histogram1d(unsigned int nb_bins) : Histogram1d(0, 1, std::max(2u, nb_bins + nb_bins%2)) {autorange = true; empty = true;}
+      Histogram1d(const Histogram1d&)            = default;
+      Histogram1d& operator=(const Histogram1d&) = default;
+
+      void add(double x) {
+	if(autorange) extend(x, x);
+	unsigned int bin = algo::Index1d(min, max, nb)(x);
+	if(bin < nb) count(bin, 1);
+      }
+
+      /**
+       * Any input iterators can be used. With an adaptive range, single pass ones are copied first, since the range is computed before counting.
+       */
+      template<typename IT>
+      void add(IT begin, IT end) {
+	if constexpr(!internal::multi_pass<IT>)
+	  if(autorange) {
+	    std::vector<double> buffer(begin, end);
+	    add(buffer.begin(), buffer.end());
+	    return;
+	  }
+	if(autorange) {
+	  auto b = algo::bounds(begin, end, [](double x) {return std::isfinite(x) ? x : std::nan("");});
+	  extend(b.first, b.second);
+	}
+	count(begin, end, algo::Index1d(min, max, nb));
+      }
+
+      /**
+       * These are the nb+1 bin edges.
+       */
+      std::vector<double> edges() const {
+	std::vector<double> res;
+	for(unsigned int b = 0; b <= nb; ++b)
+	  res.push_back(min + b*(max - min)/nb);
+	return res;
+      }
+
+    private:
+      
+      void extend(double lo, double hi) {
+	internal::cover(min, max, nb, empty, lo, hi, [this](bool towards_max) {this->merge(nb, 1, true, towards_max);});
+      }
+    };
+
+    /**
+     * This counts the samples in the nbx x nby bins regularly spread over [xmin,xmax[ x [ymin,ymax[. Bins are stored row by row. Samples are not kept.
+     *
+     * If no ranges are given, they adapt to the samples as for Histogram1d.
+     */
+    class Histogram2d : public Bins {
+    public:
+      double x_min, x_max;
+      unsigned int nbx;
+      double y_min, y_max;
+      unsigned int nby;
+      bool autorange;
+      bool x_empty, y_empty;
+
+      Histogram2d(double xmin, double xmax, unsigned int nb_xbins,
+		  double ymin, double ymax, unsigned int nb_ybins)
+	: Bins(nb_xbins*nb_ybins),
+	  x_min(xmin), x_max(xmax), nbx(nb_xbins),
+	  y_min(ymin), y_max(ymax), nby(nb_ybins),
+	  autorange(false), x_empty(false), y_empty(false) {}
+      Histogram2d(unsigned int nb_xbins, unsigned int nb_ybins)
+	: Histogram2d(0, 1, std::max(2u, nb_xbins + nb_xbins%2),
+		      0, 1, std::max(2u, nb_ybins + nb_ybins%2)) {autorange = true; x_empty = true; y_empty = true;}
+      Histogram2d(const Histogram2d&)            = default;
+      Histogram2d& operator=(const Histogram2d&) = default;
+
+      void add(const Point& pt) {
+	if(autorange && internal::finite(pt)) extend(pt.x, pt.x, pt.y, pt.y);
+	unsigned int bin = algo::Index2d(x_min, x_max, nbx, y_min, y_max, nby)(pt);
+	if(bin < counts.size()) count(bin, 1);
+      }
+
+      /**
+       * Any input iterators can be used, as for Histogram1d.
+       */
+      template<typename IT>
+      void add(IT begin, IT end) {
+	if constexpr(!internal::multi_pass<IT>)
+	  if(autorange) {
+	    std::vector<Point> buffer(begin, end);
+	    add(buffer.begin(), buffer.end());
+	    return;
+	  }
+	if(autorange) {
+	  auto bx = algo::bounds(begin, end, [](const Point& p) {return internal::finite(p) ? p.x : std::nan("");});
+	  auto by = algo::bounds(begin, end, [](const Point& p) {return internal::finite(p) ? p.y : std::nan("");});
+	  extend(bx.first, bx.second, by.first, by.second);
+	}
+	count(begin, end, algo::Index2d(x_min, x_max, nbx, y_min, y_max, nby));
+      }
+
+      std::vector<double> x_edges() const {
+	std::vector<double> res;
+	for(unsigned int b = 0; b <= nbx; ++b)
+	  res.push_back(x_min + b*(x_max - x_min)/nbx);
+	return res;
+      }
+
+      std::vector<double> y_edges() const {
+	std::vector<double> res;
+	for(unsigned int b = 0; b <= nby; ++b)
+	  res.push_back(y_min + b*(y_max - y_min)/nby);
+	return res;
+      }
+
+    private:
+      
+      void extend(double xlo, double xhi, double ylo, double yhi) {
+	internal::cover(x_min, x_max, nbx, x_empty, xlo, xhi, [this](bool towards_max) {this->merge(nbx, nby, true,  towards_max);});
+	internal::cover(y_min, y_max, nby, y_empty, ylo, yhi, [this](bool towards_max) {this->merge(nbx, nby, false, towards_max);});
+      }
+    };
+
+    /**
+     * This keeps the last capacity (t,y) samples of a stream in a ring buffer, for strip charts. It also remembers how many samples have been pushed since the previous frame, so that only these are sent.
+     */
+    class Strip {
+    public:
+      
+      std::size_t capacity;
+      std::vector<double> t, y;
+      std::size_t head;    //!< The index where the next sample is written.
+      std::size_t count;   //!< The number of samples in the buffer.
+      std::size_t pending; //!< The number of samples pushed since the previous frame, at most capacity.
+      bool reset;          //!< Whether the buffer has been cleared since the previous frame.
+
+      Strip(std::size_t capacity)
+	: capacity(std::max(capacity, std::size_t(1))), t(this->capacity), y(this->capacity), head(0), count(0), pending(0), reset(false) {}
+
+      void push(double time, double value) {
+	t[head] = time;
+	y[head] = value;
+	head = (head + 1) % capacity;
+	count   = std::min(count + 1, capacity);
+	pending = std::min(pending + 1, capacity);
+      }
+
+      std::size_t size() const {return count;}
+
+      /**
+       * This is the i-th sample, from the oldest one.
+       */
+      Point operator[](std::size_t i) const {
+	std::size_t idx = (head + capacity - count + i) % capacity;
+	return {t[idx], y[idx]};
+      }
+
+      /**
+       * This empties the buffer. The viewer forgets the samples it has received at next frame.
+       */
+      void clear() {
+	head = count = pending = 0;
+	reset = true;
+      }
+
+      /**
+       * This is called by the elements once the pending samples have been sent.
+       */
+      void next_frame() {
+	pending = 0;
+	reset   = false;
+      }
+    };
+
+    /**
+     * This accumulates points that are only added, for scatter plots that grow along the run. If a maximal number of points is given, a uniform sample of that size of all the points added so far is kept (reservoir sampling): beyond the maximum, a new point replaces a random one, or is dropped. The points added or replaced since the previous frame are remembered, so that only these are sent.
+     */
+    class Scatter {
+    public:
+      
+      std::vector<Point> points;
+      std::size_t max_points;        //!< 0 means no limit.
+      std::size_t nb_added;          //!< The number of points added so far.
+      std::size_t sent;              //!< points[0..sent[ have been sent.
+      std::vector<std::size_t> replaced; //!< The indices replaced since the previous frame.
+      std::vector<char> dirty;           // dirty[i] tells if i is in replaced.
+      bool reset;                        //!< Whether the points have been cleared since the previous frame.
+      std::mt19937 gen;
+
+      Scatter(std::size_t max_points = 0, unsigned int seed = 0)
+	: points(), max_points(max_points), nb_added(0), sent(0), replaced(), dirty(), reset(false), gen(seed) {}
+
+      void add(const Point& pt) {
+	++nb_added;
+	if(max_points == 0 || points.size() < max_points) {
+	  points.push_back(pt);
+	  return;
+	}
+	std::size_t j = std::uniform_int_distribution<std::size_t>(0, nb_added - 1)(gen);
+	if(j >= max_points) return;
+	points[j] = pt;
+	if(j < sent) {
+	  if(dirty.size() < sent) dirty.resize(sent, 0);
+	  if(!dirty[j]) {
+	    dirty[j] = 1;
+	    replaced.push_back(j);
+	  }
+	}
+      }
+
+      template<typename IT>
+      void add(IT begin, IT end) {
+	for(auto it = begin; it != end; ++it) add(*it);
+      }
+
+      /**
+       * This removes all the points. The viewer forgets the points it has received at next frame.
+       */
+      void clear() {
+	points.clear();
+	nb_added = 0;
+	sent      = 0;
+	replaced.clear();
+	dirty.clear();
+	reset = true;
+      }
+
+      /**
+       * This is called by the elements once the new points have been sent.
+       */
+      void next_frame() {
+	for(auto i : replaced) dirty[i] = 0;
+	replaced.clear();
+	sent  = points.size();
+	reset = false;
+      }
+    };
+
+    /**
+     * This keeps the last nb_rows rows, of width values each, of a waterfall (or spectrogram) in a circular buffer. The rows are either given directly, or computed as the spectra of blocks of samples. The number of rows pushed since the previous frame is remembered, so that only these are sent.
+     */
+    class Waterfall {
+    public:
+
+      unsigned int nb_rows;
+      unsigned int width;
+      double x_min, x_max;     //!< The left edge of the first column and the right edge of the last one.
+      std::vector<double> data;
+      unsigned int head;       //!< The row where the next one is written.
+      unsigned int count;      //!< The number of rows in the buffer.
+      unsigned int pending;    //!< The number of rows pushed since the previous frame, at most nb_rows.
+      bool reset;              //!< Whether the rows have been cleared since the previous frame.
+
+    private:
+      
+      std::vector<double> block;
+      std::vector<std::complex<double>> spectrum;
+
+    public:
+      
+      Waterfall(unsigned int nb_rows, unsigned int width, double x_min, double x_max)
+	: nb_rows(std::max(nb_rows, 1u)), width(width), x_min(x_min), x_max(x_max),
+	  data(this->nb_rows*width, 0), head(0), count(0), pending(0), reset(false), block(), spectrum() {}
+      Waterfall(unsigned int nb_rows, unsigned int width) : Waterfall(nb_rows, width, 0, width) {}
+
+      /**
+       * This adds a row. Missing values are NaN, extra ones are ignored.
+       */
+      template<typename IT>
+      void push(IT begin, IT end) {
+	auto out = data.begin() + head*width;
+	unsigned int i = 0;
+	for(auto it = begin; it != end && i < width; ++it, ++i) *(out++) = *it;
+	for(; i < width; ++i) *(out++) = std::nan("");
+	head    = (head + 1) % nb_rows;
+	count   = std::min(count + 1, nb_rows);
+	pending = std::min(pending + 1, nb_rows);
+      }
+
+      /**
+       * This adds the modulus of the discrete Fourier transform of a block of 2*(width-1) samples, which must be a power of 2, as a row. If hann is true, the block is multiplied by a Hann window first.
+       */
+      template<typename IT>
+      void push_spectrum(IT begin, IT end, bool hann = true) {
+	block.assign(begin, end);
+	std::size_t n = block.size();
+	if(n < 2 || (n & (n - 1)) != 0 || n/2 + 1 != width)
+	  throw std::runtime_error("ccmpl::stats::Waterfall::push_spectrum : the block size has to be a power of 2, equal to 2*(width-1)");
+	if(hann)
+	  for(std::size_t i = 0; i < n; ++i)
+	    block[i] *= .5*(1 - std::cos(2*M_PI*i/(n - 1)));
+	algo::real_fft(block, spectrum);
+	block.resize(width);
+	for(unsigned int k = 0; k < width; ++k) block[k] = std::abs(spectrum[k]);
+	push(block.begin(), block.end());
+      }
+
+      /**
+       * This is the beginning of the i-th row, from the oldest one.
+       */
+      std::vector<double>::const_iterator row(unsigned int i) const {
+	return data.begin() + ((head + nb_rows - count + i) % nb_rows)*width;
+      }
+
+      /**
+       * This removes all the rows. The viewer blanks the rows it has received at next frame.
+       */
+      void clear() {
+	head = count = pending = 0;
+	reset = true;
+      }
+
+      /**
+       * This is called by the elements once the pending rows have been sent.
+       */
+      void next_frame() {
+	pending = 0;
+	reset   = false;
+      }
+    };
+
+    /**
+     * This is a t-digest (T. Dunning, 2019), i.e. a sketch of the distribution of a stream of samples from which quantiles can be estimated, in bounded memory. Samples are buffered, and the buffer is merged into at most about compression centroids when it is full, which makes insertions amortized constant time. The centroids are small near the extreme quantiles, so that tails are accurate. Digests can be merged.
+     */
+    class Digest {
+    public:
+
+      struct Centroid {
+	double mean, weight;
+      };
+
+      double compression;
+      std::vector<Centroid> centroids; //!< Sorted by mean, once flushed.
+      double total;                    //!< The weight of the merged centroids.
+      double min, max;
+
+    private:
+
+      std::vector<Centroid> buffer;
+      std::vector<Centroid> merged;
+
+      double k(double q) const {return compression/(2*M_PI)*std::asin(2*std::min(std::max(q, 0.), 1.) - 1);}
+      double k_inv(double kq) const {
+	return kq >= compression/4 ? 1 : .5*(std::sin(2*M_PI*kq/compression) + 1);
+      }
+
+    public:
+
+      Digest(double compression = 100)
+	: compression(compression), centroids(), total(0), min(HUGE_VAL), max(-HUGE_VAL), buffer(), merged() {
+	buffer.reserve(5*std::size_t(compression));
+      }
+
+      void add(double x) {
+	if(!std::isfinite(x)) return;
+	min = std::min(min, x);
+	max = std::max(max, x);
+	buffer.push_back({x, 1});
+	if(buffer.size() >= 5*std::size_t(compression)) flush();
+      }
+
+      template<typename IT>
+      void add(IT begin, IT end) {
+	for(auto it = begin; it != end; ++it) add(*it);
+      }
+
+      void merge(Digest& other) {
+	other.flush();
+	for(auto& c : other.centroids) buffer.push_back(c);
+	min = std::min(min, other.min);
+	max = std::max(max, other.max);
+	flush();
+      }
+
+      void clear() {
+	centroids.clear();
+	buffer.clear();
+	total = 0;
+	min   = HUGE_VAL;
+	max   = -HUGE_VAL;
+      }
+
+      /**
+       * This merges the buffered samples into the centroids.
+       */
+      void flush() {
+	if(buffer.size() == 0) return;
+	std::sort(buffer.begin(), buffer.end(), [](const Centroid& a, const Centroid& b) {return a.mean < b.mean;});
+	merged.clear();
+	std::merge(centroids.begin(), centroids.end(), buffer.begin(), buffer.end(), std::back_inserter(merged),
+		   [](const Centroid& a, const Centroid& b) {return a.mean < b.mean;});
+	buffer.clear();
+	total = 0;
+	for(auto& c : merged) total += c.weight;
+	
+	centroids.clear();
+	Centroid current = merged.front();
+	double so_far  = 0;
+	double q_limit = k_inv(k(0) + 1);
+	for(auto it = merged.begin() + 1; it != merged.end(); ++it) {
+	  if((so_far + current.weight + it->weight)/total <= q_limit) {
+	    current.mean  += (it->mean - current.mean)*it->weight/(current.weight + it->weight);
+	    current.weight += it->weight;
+	  }
+	  else {
+	    so_far += current.weight;
+	    centroids.push_back(current);
+	    q_limit = k_inv(k(so_far/total) + 1);
+	    current = *it;
+	  }
+	}
+	centroids.push_back(current);
+      }
+
+      double count() {
+	flush();
+	return total;
+      }
+
+      /**
+       * The mean is exact, merging centroids keeps it.
+       */
+      double mean() {
+	flush();
+	double sum = 0;
+	for(auto& c : centroids) sum += c.mean*c.weight;
+	return total == 0 ? std::nan("") : sum/total;
+      }
+
+      /**
+       * This estimates the q-quantile (q in [0,1]), interpolating linearly between the centers of the centroids. It is NaN if there are no samples.
+       */
+      double quantile(double q) {
+	flush();
+	if(centroids.size() == 0) return std::nan("");
+	double index = std::min(std::max(q, 0.), 1.)*total;
+	double before = 0;
+	double prev_center = 0, prev_mean = min;
+	for(auto& c : centroids) {
+	  double center = before + .5*c.weight;
+	  if(index <= center) {
+	    if(center == prev_center) return c.mean;
+	    return prev_mean + (index - prev_center)*(c.mean - prev_mean)/(center - prev_center);
+	  }
+	  prev_center = center;
+	  prev_mean   = c.mean;
+	  before     += c.weight;
+	}
+	if(total == prev_center) return max;
+	return prev_mean + (index - prev_center)*(max - prev_mean)/(total - prev_center);
+      }
+
+      /**
+       * This estimates the fraction of the samples lower than x, inverting the interpolation of quantile.
+       */
+      double cdf(double x) {
+	flush();
+	if(centroids.size() == 0 || x < min) return 0;
+	if(x >= max) return 1;
+	double before = 0;
+	double prev_center = 0, prev_mean = min;
+	for(auto& c : centroids) {
+	  double center = before + .5*c.weight;
+	  if(x < c.mean) {
+	    if(c.mean == prev_mean) return prev_center/total;
+	    return (prev_center + (x - prev_mean)*(center - prev_center)/(c.mean - prev_mean))/total;
+	  }
+	  prev_center = center;
+	  prev_mean   = c.mean;
+	  before     += c.weight;
+	}
+	return (prev_center + (x - prev_mean)*(total - prev_center)/(max - prev_mean))/total;
+      }
+    };
+
+    /**
+     * This estimates the p-quantile of a stream in constant memory with the P² algorithm (R. Jain and I. Chlamtac, 1985): five markers are kept, whose heights are adjusted with a piecewise parabolic interpolation as samples arrive.
+     */
+    class P2 {
+    private:
+      
+      double q[5];  // marker heights.
+      double n[5];  // marker positions.
+      double np[5]; // desired marker positions.
+      double dn[5]; // increments of the desired positions.
+      
+      double parabolic(int i, double d) const {
+	return q[i] + d/(n[i+1] - n[i-1])*((n[i] - n[i-1] + d)*(q[i+1] - q[i])/(n[i+1] - n[i])
+					   + (n[i+1] - n[i] - d)*(q[i] - q[i-1])/(n[i] - n[i-1]));
+      }
+      
+      double linear(int i, int d) const {
+	return q[i] + d*(q[i+d] - q[i])/(n[i+d] - n[i]);
+      }
+      
+    public:
+      
+      double p;
+      unsigned long count;
+
+      P2(double p = .5) : q{0, 0, 0, 0, 0}, n{1, 2, 3, 4, 5}, np{1, 1 + 2*p, 1 + 4*p, 3 + 2*p, 5}, dn{0, p/2, p, (1 + p)/2, 1}, p(p), count(0) {}
+
+      void add(double x) {
+	if(count < 5) {
+	  q[count++] = x;
+	  if(count == 5) std::sort(q, q + 5);
+	  return;
+	}
+	int k;
+	if(x < q[0])       {q[0] = x; k = 0;}
+	else if(x >= q[4]) {q[4] = x; k = 3;}
+	else for(k = 0; x >= q[k+1]; ++k);
+	for(int i = k + 1; i < 5; ++i) n[i] += 1;
+	for(int i = 0; i < 5; ++i)     np[i] += dn[i];
+	for(int i = 1; i < 4; ++i) {
+	  double d = np[i] - n[i];
+	  if((d >= 1 && n[i+1] - n[i] > 1) || (d <= -1 && n[i-1] - n[i] < -1)) {
+	    int s = d > 0 ? 1 : -1;
+	    double h = parabolic(i, s);
+	    q[i] = (q[i-1] < h && h < q[i+1]) ? h : linear(i, s);
+	    n[i] += s;
+	  }
+	}
+	++count;
+      }
+
+      /**
+       * This is the estimation, exact while less than five samples have been added (NaN if none).
+       */
+      double value() const {
+	if(count >= 5) return q[2];
+	if(count == 0) return std::nan("");
+	double sorted[5];
+	std::copy(q, q + count, sorted);
+	std::sort(sorted, sorted + count);
+	return sorted[std::size_t(std::lround(p*(count - 1)))];
+      }
+    };
+
+    /**
+     * This accumulates an ensemble of runs of a curve sampled at the abscissas x: at each abscissa, the mean and variance of the values are updated with the Welford algorithm, and, if quantiles are given, the low and high quantiles are estimated with the P² algorithm. Updates are computed in parallel over the abscissas.
+     */
+    class Ensemble {
+    public:
+
+      std::vector<double> x;
+      std::vector<unsigned long> count;
+      std::vector<double> mean;
+      std::vector<double> m2;       //!< The sums of the squared deviations to the mean.
+      bool percentiles;             //!< Whether low and high are estimated.
+      std::vector<P2> low, high;
+
+      Ensemble(const std::vector<double>& x)
+	: x(x), count(x.size(), 0), mean(x.size(), 0), m2(x.size(), 0), percentiles(false), low(), high() {}
+      
+      Ensemble(const std::vector<double>& x, double low_quantile, double high_quantile)
+	: x(x), count(x.size(), 0), mean(x.size(), 0), m2(x.size(), 0), percentiles(true),
+	  low(x.size(), P2(low_quantile)), high(x.size(), P2(high_quantile)) {}
+
+      /**
+       * This adds the value of a run at the i-th abscissa. NaN values are ignored.
+       */
+      void add(std::size_t i, double value) {
+	if(std::isnan(value)) return;
+	double delta = value - mean[i];
+	mean[i] += delta/(++count[i]);
+	m2[i]   += delta*(value - mean[i]);
+	if(percentiles) {
+	  low[i].add(value);
+	  high[i].add(value);
+	}
+      }
+
+      /**
+       * This adds a whole run, values[i] being the value at x[i].
+       */
+      void add(const std::vector<double>& values) {
+	internal::parallel_for(std::min(values.size(), x.size()), 1024,
+			       [this, &values](unsigned int, std::size_t first, std::size_t last) {
+				 for(std::size_t i = first; i < last; ++i) add(i, values[i]);
+			       });
+      }
+
+      double variance(std::size_t i) const {
+	return count[i] > 1 ? m2[i]/(count[i] - 1) : 0;
+      }
+
+      double deviation(std::size_t i) const {
+	return std::sqrt(variance(i));
+      }
+
+      void clear() {
+	std::fill(count.begin(), count.end(), 0);
+	std::fill(mean.begin(), mean.end(), 0);
+	std::fill(m2.begin(), m2.end(), 0);
+	if(percentiles) {
+	  for(auto& l : low)  l = P2(l.p);
+	  for(auto& h : high) h = P2(h.p);
+	}
+      }
+    };
+
+    /**
+     * This keeps the samples of a stream sorted, for empirical cumulative distribution functions. Each chunk of samples is sorted (in parallel) and merged with the ones already there, so that the samples do not need to be sorted again at each frame.
+     */
+    class Ecdf {
+    public:
+
+      std::vector<double> values; //!< The samples, sorted.
+
+      Ecdf() : values() {}
+
+      template<typename IT>
+      void add(IT begin, IT end) {
+	std::size_t size = values.size();
+	values.insert(values.end(), begin, end);
+	algo::parallel_sort(values.begin() + size, values.end());
+	std::inplace_merge(values.begin(), values.begin() + size, values.end());
+      }
+
+      /**
+       * This adds a chunk whose samples are already sorted.
+       */
+      template<typename IT>
+      void add_sorted(IT begin, IT end) {
+	std::size_t size = values.size();
+	values.insert(values.end(), begin, end);
+	std::inplace_merge(values.begin(), values.begin() + size, values.end());
+      }
+
+      void clear() {
+	values.clear();
+      }
+
+      /**
+       * This is the q-quantile of the samples (NaN if there are none).
+       */
+      double quantile(double q) const {
+	if(values.size() == 0) return std::nan("");
+	q = std::min(std::max(q, 0.), 1.);
+	return values[std::min(values.size() - 1, std::size_t(q*values.size()))];
+      }
+    };
+  }
+}
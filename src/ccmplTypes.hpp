@@ -27,6 +27,7 @@
 #pragma once
 
 #include <cmath>
+#include <algorithm>
 #include <iostream>
 
 namespace ccmpl {
@@ -202,6 +203,14 @@ namespace ccmpl {
 
     virtual ~Patch() {}
     virtual void toPython(std::ostream& os)=0;
+
+    /**
+     * This tells whether the patch may be visible in [xmin,xmax]x[ymin,ymax]. It is conservative: a patch whose bounding box overlaps the area is considered as visible.
+     */
+    virtual bool intersects(double xmin, double xmax, double ymin, double ymax) const {
+      return true;
+    }
+    
     virtual void print_attr(std::ostream& os) {
       gc.print_edgecolor(os);
       os << ',';
@@ -230,6 +239,10 @@ namespace ccmpl {
       Circle(const Circle&) = default;
       Circle& operator=(const Circle&) = default;
       virtual ~Circle() {}
+      virtual bool intersects(double xmin, double xmax, double ymin, double ymax) const {
+	return center.x + radius >= xmin && center.x - radius <= xmax
+	  &&   center.y + radius >= ymin && center.y - radius <= ymax;
+      }
       virtual void toPython(std::ostream& os) {
 	os << "patches.Circle(("
 	   << center.x << ',' << center.y << "), " << radius << ", ";
@@ -248,6 +261,14 @@ namespace ccmpl {
       Rectangle(const Rectangle&) = default;
       Rectangle& operator=(const Rectangle&) = default;
       virtual ~Rectangle() {}
+      virtual bool intersects(double xmin, double xmax, double ymin, double ymax) const {
+	// The rectangle is rotated by angle degrees around its origin.
+	double c = std::cos(angle*M_PI/180), s = std::sin(angle*M_PI/180);
+	double xs[4] = {0, width*c, width*c - height*s, -height*s};
+	double ys[4] = {0, width*s, width*s + height*c,  height*c};
+	return origin.x + *std::max_element(xs, xs+4) >= xmin && origin.x + *std::min_element(xs, xs+4) <= xmax
+	  &&   origin.y + *std::max_element(ys, ys+4) >= ymin && origin.y + *std::min_element(ys, ys+4) <= ymax;
+      }
       virtual void toPython(std::ostream& os) {
 	os << "patches.Rectangle(("
 	   << origin.x << ',' << origin.y << "), "
@@ -269,6 +290,10 @@ namespace ccmpl {
       Arrow(const Arrow&) = default;
       Arrow& operator=(const Arrow&) = default;
       virtual ~Arrow() {}
+      virtual bool intersects(double xmin, double xmax, double ymin, double ymax) const {
+	return std::max(x, x+dx) + width >= xmin && std::min(x, x+dx) - width <= xmax
+	  &&   std::max(y, y+dy) + width >= ymin && std::min(y, y+dy) - width <= ymax;
+      }
       virtual void toPython(std::ostream& os) {
 	os << "patches.Arrow("
 	   << x << "," << y << "," << dx << "," << dy
@@ -293,6 +318,11 @@ namespace ccmpl {
       FancyArrow(const FancyArrow&) = default;
       FancyArrow& operator=(const FancyArrow&) = default;
       virtual ~FancyArrow() {}
+      virtual bool intersects(double xmin, double xmax, double ymin, double ymax) const {
+	double margin = std::max(width, head_width) + head_length;
+	return std::max(x, x+dx) + margin >= xmin && std::min(x, x+dx) - margin <= xmax
+	  &&   std::max(y, y+dy) + margin >= ymin && std::min(y, y+dy) - margin <= ymax;
+      }
       virtual void toPython(std::ostream& os) {
 	os << "patches.FancyArrow("
 	   << x << ',' << y << ',' << dx << ',' << dy
@@ -320,6 +350,10 @@ namespace ccmpl {
      Wedge(const Wedge&) = default;
      Wedge& operator=(const Wedge&) = default;
      virtual ~Wedge() {}
+     virtual bool intersects(double xmin, double xmax, double ymin, double ymax) const {
+       return center.x + radius >= xmin && center.x - radius <= xmax
+	 &&   center.y + radius >= ymin && center.y - radius <= ymax;
+     }
      virtual void toPython(std::ostream& os) {
        os << "patches.Wedge(" 
 	  << "(" << center.x << "," << center.y << ")," 
@@ -344,6 +378,11 @@ namespace ccmpl {
      Arc(const Arc&) = default;
      Arc& operator=(const Arc&) = default;
      virtual ~Arc() {}
+     virtual bool intersects(double xmin, double xmax, double ymin, double ymax) const {
+       double radius = .5*std::max(width, height);
+       return center.x + radius >= xmin && center.x - radius <= xmax
+	 &&   center.y + radius >= ymin && center.y - radius <= ymax;
+     }
      virtual void toPython(std::ostream& os) {
        os << "patches.Arc(" 
 	  << "(" << center.x << "," << center.y << ")," 
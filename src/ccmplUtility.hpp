@@ -30,9 +30,221 @@
 #include <sstream>
 #include <iomanip>
 #include <iterator>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <cstddef>
+#include <atomic>
+#include <type_traits>
+#include <cmath>
+#include <exception>
+
+#include <ccmplTypes.hpp>
 
 namespace ccmpl {
 
+  namespace internal {
+
+    /**
+     * These tell whether the parallel algorithms can split a range of iterators in chunks, or whether it can be read more than once.
+     */
+    template<typename IT>
+    constexpr bool random_access = std::is_base_of<std::random_access_iterator_tag,
+						   typename std::iterator_traits<IT>::iterator_category>::value;
+    template<typename IT>
+    constexpr bool multi_pass    = std::is_base_of<std::forward_iterator_tag,
+						   typename std::iterator_traits<IT>::iterator_category>::value;
+
+    inline unsigned int nb_threads() {
+      unsigned int nb = std::thread::hardware_concurrency();
+      return nb == 0 ? 1 : nb;
+    }
+
+    /**
+     * This is the amount of elementary work (roughly, inner loop iterations) below which spawning a thread costs more than it saves.
+     */
+    constexpr std::size_t parallel_work = 1 << 14;
+
+    /**
+     * This is the grain to pass to parallel_for when each item costs about item_cost elementary operations, so that no thread is given less than parallel_work.
+     */
+    inline std::size_t grain_for(std::size_t item_cost) {
+      return std::max<std::size_t>(1, parallel_work/std::max<std::size_t>(item_cost, 1));
+    }
+
+    /**
+     * This is the number of chunks [0,size) is split into by parallel_for, each chunk containing at least grain items. It is 1, i.e. serial processing, when size is below two grains.
+     */
+    inline unsigned int nb_chunks(std::size_t size, std::size_t grain) {
+      if(grain == 0) grain = 1;
+      std::size_t nb = size / grain;
+      if(nb == 0) nb = 1;
+      return (unsigned int)(std::min<std::size_t>(nb, nb_threads()));
+    }
+
+    // This runs the workers, the first one in the calling thread, and
+    // rethrows in the caller the first exception thrown by any of them
+    // once they are all joined.
+    template<typename WORK>
+    void run_workers(unsigned int nb, const WORK& work) {
+      std::vector<std::exception_ptr> errors(nb);
+      auto guarded = [&work, &errors](unsigned int c) {
+	try {work(c);}
+	catch(...) {errors[c] = std::current_exception();}
+      };
+      std::vector<std::thread> threads;
+      threads.reserve(nb-1);
+      for(unsigned int c = 1; c < nb; ++c)
+	threads.emplace_back(guarded, c);
+      guarded(0);
+      for(auto& t : threads) t.join();
+      for(auto& e : errors)
+	if(e) std::rethrow_exception(e);
+    }
+
+    /**
+     * This calls f(chunk, begin, end) for each of the nb_chunks(size, grain) contiguous chunks of [0,size), each chunk being handled by its own thread. Chunk indices allow the callers to fill per-chunk private data and reduce it afterwards. A single chunk is processed in the calling thread. An exception thrown by f is rethrown here, after all the chunks are done.
+     */
+    template<typename FUN>
+    void parallel_for(std::size_t size, std::size_t grain, const FUN& f) {
+      if(size == 0) return;
+      unsigned int nb = nb_chunks(size, grain);
+      if(nb == 1) {
+	f(0u, std::size_t(0), size);
+	return;
+      }
+      run_workers(nb, [&f, nb, size](unsigned int c) {f(c, (c*size)/nb, ((c+1)*size)/nb);});
+    }
+
+    /**
+     * This calls f(begin, end) for the chunks of grain items of [0,size), which nb_threads() threads pick one after the other, so that the load is balanced even if the cost of the items varies. A single chunk is processed in the calling thread. An exception thrown by f stops the distribution of the remaining chunks and is rethrown here.
+     */
+    template<typename FUN>
+    void parallel_for_dynamic(std::size_t size, std::size_t grain, const FUN& f) {
+      if(size == 0) return;
+      if(grain == 0) grain = 1;
+      std::size_t nb_blocks = (size + grain - 1)/grain;
+      if(nb_blocks == 1) {
+	f(std::size_t(0), size);
+	return;
+      }
+      unsigned int nb = (unsigned int)(std::min<std::size_t>(nb_blocks, nb_threads()));
+      std::atomic<std::size_t> next(0);
+      run_workers(nb, [&f, &next, nb_blocks, grain, size](unsigned int) {
+	  try {
+	    for(std::size_t b = next++; b < nb_blocks; b = next++)
+	      f(b*grain, std::min(size, (b + 1)*grain));
+	  }
+	  catch(...) {
+	    next = nb_blocks;
+	    throw;
+	  }
+	});
+    }
+  }
+
+
+  namespace internal {
+
+    // This approximates atan2(y, x) with a polynomial. Its tests are
+    // selections that compilers turn into blends, so that loops calling
+    // it can be vectorized.
+    inline double fast_atan2(double y, double x) {
+      double ax = std::abs(x), ay = std::abs(y);
+      double mx = std::max(ax, ay), mn = std::min(ax, ay);
+      double a  = mx == 0 ? 0 : mn/mx;
+      double s  = a*a;
+      double r  = ((((-0.013480470*s + 0.057477314)*s - 0.121239071)*s + 0.195635925)*s - 0.332994597)*s*a + 0.999995630*a;
+      r = ay > ax ? M_PI/2 - r : r;
+      r = x < 0   ? M_PI - r   : r;
+      return y < 0 ? -r : r;
+    }
+
+    // This is component_level(theta), without branches, for t =
+    // theta/(pi/3) in [0,6).
+    inline double wheel_level(double t) {
+      return std::min(std::max(std::min(t - 2, 6 - t), 0.), 1.);
+    }
+
+    inline RGB wheel_color(double x, double y) {
+      double t = fast_atan2(y, x)*(3/M_PI);      // in [-3,3]
+      double n = std::min(std::sqrt(x*x + y*y), 1.);
+      double tr = t + 6*(t < 0);                 // in [0,6)
+      double tg = tr + 2; tg -= 6*(tg >= 6);
+      double tb = tr + 4; tb -= 6*(tb >= 6);
+      return {n*wheel_level(tr) + (1 - n), n*wheel_level(tg) + (1 - n), n*wheel_level(tb) + (1 - n)};
+    }
+  }
+
+  namespace color {
+
+    /**
+     * This computes ccmpl::color::from_point for all the points, in parallel over chunks. The angle is computed by a polynomial approximation of atan2 (error about 1e-5 rad) and the color levels without branches, so that the loop can be vectorized.
+     */
+    template<typename VALUE, typename POINT>
+    void from_points(const std::vector<POINT>& points,
+		     VALUE xmin, VALUE xmax,
+		     VALUE ymin, VALUE ymax,
+		     std::vector<RGB>& colors) {
+      colors.resize(points.size());
+      double xcoef = 2/(double)(xmax - xmin), ycoef = 2/(double)(ymax - ymin);
+      internal::parallel_for(points.size(), 4096,
+			     [&points, &colors, xmin, ymin, xcoef, ycoef](unsigned int, std::size_t first, std::size_t last) {
+			       for(std::size_t i = first; i < last; ++i)
+				 colors[i] = internal::wheel_color((points[i].x - xmin)*xcoef - 1, (points[i].y - ymin)*ycoef - 1);
+			     });
+    }
+
+    /**
+     * This is a lookup table of colors, sampled from a function f(t), t in [0,1], that gives the color of a scalar.
+     */
+    class Table {
+    public:
+      
+      std::vector<RGB> colors;
+
+      template<typename F>
+      Table(const F& f, unsigned int nb = 256) : colors() {
+	nb = std::max(nb, 2u);
+	for(unsigned int i = 0; i < nb; ++i) colors.push_back(f(i/(nb - 1.)));
+      }
+
+      /**
+       * This is the color of t in [0,1] (clamped), linearly interpolated between the entries. NaN values get the first color.
+       */
+      RGB operator()(double t) const {
+	double pos = std::min(std::max(t, 0.), 1.)*(colors.size() - 1);
+	pos = pos == pos ? pos : 0;
+	std::size_t i = std::min(std::size_t(pos), colors.size() - 2);
+	double w = pos - i;
+	const RGB& a = colors[i];
+	const RGB& b = colors[i + 1];
+	return {a.r + w*(b.r - a.r), a.g + w*(b.g - a.g), a.b + w*(b.b - a.b)};
+      }
+    };
+
+    /**
+     * This table goes around the hue circle of ccmpl::color::from_point, with full saturation.
+     */
+    inline Table hue(unsigned int nb = 256) {
+      return Table([](double t) {return internal::wheel_color(-std::cos(2*M_PI*t), -std::sin(2*M_PI*t));}, nb);
+    }
+
+    /**
+     * This maps the values of [begin, end), scaled from [vmin, vmax] to [0, 1], to colors with the table, in parallel over chunks.
+     */
+    template<typename IT>
+    void from_values(IT begin, IT end, double vmin, double vmax, const Table& table, std::vector<RGB>& colors) {
+      colors.resize(std::distance(begin, end));
+      double coef = vmax > vmin ? 1/(vmax - vmin) : 0;
+      internal::parallel_for(colors.size(), 4096,
+			     [begin, &colors, &table, vmin, coef](unsigned int, std::size_t first, std::size_t last) {
+			       auto it = begin + first;
+			       for(std::size_t i = first; i < last; ++i, ++it)
+				 colors[i] = table((*it - vmin)*coef);
+			     });
+    }
+  }
 
   inline std::string filename(const std::string& prefix, unsigned int i, const std::string& suffix) {
     std::ostringstream ostr;
@@ -89,8 +301,106 @@ namespace ccmpl {
 
     iterator begin() const {return iterator( 0,min,max,nb);}
     iterator end()   const {return iterator(nb,min,max,nb);}
+
+    std::size_t size() const {return nb;}
+    double operator[](std::size_t i) const {return nb < 2 ? min : min + i*((max-min)/(nb-1));}
   };
 
+  // The following helpers evaluate a function over ranges, in
+  // parallel. Chunks of evaluations are scheduled dynamically, since
+  // the cost of the function may vary, so f has to be thread-safe.
+
+  /**
+   * This fills points with (x, f(x)), x in rx, as ccmpl::line expects.
+   */
+  template<typename F>
+  void eval_line(const F& f, const range& rx, std::vector<Point>& points) {
+    points.resize(rx.size());
+    internal::parallel_for_dynamic(rx.size(), 64,
+				   [&f, &rx, &points](std::size_t first, std::size_t last) {
+				     for(std::size_t i = first; i < last; ++i) points[i] = {rx[i], f(rx[i])};
+				   });
+  }
+
+  /**
+   * This fills z with f(x, y) on the grid rx x ry, row by row (y = ry[0] first), as ccmpl::contours and the gray ccmpl::image expect.
+   */
+  template<typename F>
+  void eval_grid(const F& f, const range& rx, const range& ry, std::vector<double>& z) {
+    std::size_t width = rx.size();
+    z.resize(width*ry.size());
+    internal::parallel_for_dynamic(ry.size(), std::max<std::size_t>(1, 256/std::max<std::size_t>(width, 1)),
+				   [&f, &rx, &ry, &z, width](std::size_t first, std::size_t last) {
+				     for(std::size_t j = first; j < last; ++j) {
+				       double y = ry[j];
+				       auto out = z.begin() + j*width;
+				       for(std::size_t i = 0; i < width; ++i) *(out++) = f(rx[i], y);
+				     }
+				   });
+  }
+
+  /**
+   * This sets all the arguments of a ccmpl::image fill function from f(x, y) on the grid rx x ry. If f returns a ccmpl::RGB, the image is a color one (depth = 3), otherwise it is a gray one.
+   */
+  template<typename F>
+  void eval_image(const F& f, const range& rx, const range& ry,
+		  std::vector<double>& x, std::vector<double>& y, std::vector<double>& z,
+		  unsigned int& width, unsigned int& depth) {
+    x.assign(rx.begin(), rx.end());
+    y.assign(ry.begin(), ry.end());
+    width = rx.size();
+    if constexpr (std::is_same<typename std::decay<decltype(f(0., 0.))>::type, RGB>::value) {
+      depth = 3;
+      z.resize(3*std::size_t(width)*ry.size());
+      internal::parallel_for_dynamic(ry.size(), std::max<std::size_t>(1, 256/std::max(width, 1u)),
+				     [&f, &rx, &ry, &z, width](std::size_t first, std::size_t last) {
+				       for(std::size_t j = first; j < last; ++j) {
+					 double yj = ry[j];
+					 auto out = z.begin() + 3*j*width;
+					 for(std::size_t i = 0; i < width; ++i) {
+					   RGB c = f(rx[i], yj);
+					   *(out++) = c.r;
+					   *(out++) = c.g;
+					   *(out++) = c.b;
+					 }
+				       }
+				     });
+    }
+    else {
+      depth = 1;
+      eval_grid(f, rx, ry, z);
+    }
+  }
+
+  /**
+   * This fills values with f(x, y) on the grid rx x ry, as ccmpl::surface expects.
+   */
+  template<typename F>
+  void eval_values(const F& f, const range& rx, const range& ry, std::vector<ValueAt>& values) {
+    std::size_t width = rx.size();
+    values.resize(width*ry.size());
+    internal::parallel_for_dynamic(values.size(), 256,
+				   [&f, &rx, &ry, &values, width](std::size_t first, std::size_t last) {
+				     for(std::size_t c = first; c < last; ++c) {
+				       double x = rx[c % width], y = ry[c / width];
+				       values[c] = {x, y, f(x, y)};
+				     }
+				   });
+  }
+
+  /**
+   * This fills values with f(x, y) at the given points, as ccmpl::surface expects.
+   */
+  template<typename F>
+  void eval_at(const F& f, const std::vector<Point>& points, std::vector<ValueAt>& values) {
+    values.resize(points.size());
+    internal::parallel_for_dynamic(points.size(), 256,
+				   [&f, &points, &values](std::size_t first, std::size_t last) {
+				     for(std::size_t c = first; c < last; ++c)
+				       values[c] = {points[c], f(points[c].x, points[c].y)};
+				   });
+  }
+
   
   
 }